@@ -26,9 +26,31 @@
 
 ..\..\TARL\si5351a.c
 
+bustrace.c
+
+format.c
+
+fsk.c
+
 io.c
 
+keyer.c
+
+latency.c
+
 main.c
 
+message.c
+
 nvram.c
 
+sequencer.c
+
+synth.c
+
+winkey.c
+
+command.c
+
+wspr.c
+
@@ -0,0 +1,106 @@
+/*
+ * bandplan.h
+ *
+ * Generated by genbands.sh from bandplan.txt - do not edit
+ * The dividers keep the VCO in range up to 33468 Hz outside each band
+ */
+
+#ifndef BANDPLAN_H_
+#define BANDPLAN_H_
+
+// How far outside a band its dividers still keep the VCO in range
+#define BAND_DIVIDER_MARGIN 33468
+
+struct sBand
+{
+    char     *bandName;     // Text for the menu
+    uint32_t  minFreq;      // Min band frequency
+    uint32_t  maxFreq;      // Max band frequency
+    uint32_t  defaultFreq;  // Where to start on this band e.g. QRP calling
+#ifdef SOTA2
+    uint32_t  leftFreq;     // Below this frequency light the left LED
+    uint32_t  rightFreq;    // Above this frequency light the right LED
+#endif
+    bool      bTXEnabled;   // True if TX enabled on this band
+    uint8_t   relayState;   // What state to put the relays in on this band
+#ifndef SOTA2
+    bool      bQuickVFOMenu;// True if this band appears in the quick VFO menu
+#endif
+    uint16_t  outDiv;       // Even integer output divider for the band
+    uint8_t   rDiv;         // R divider for the band
+    uint8_t   rxDrive;      // RX clock output drive strength (mA)
+    uint8_t   txDrive;      // TX clock output drive strength (mA)
+};
+
+#ifdef SOTA2
+#define NUM_BANDS 2
+
+static const struct sBand band[NUM_BANDS] =
+{
+    { "40m",        7000000,   7199999,   7030000,   7020000,   7040000, true,  0,   88,   1, 8, 8 },
+    { "20m",       14000000,  14349999,  14060000,  14050000,  14070000, true,  1,   44,   1, 8, 8 },
+};
+
+#elif defined(SOTA5)
+#define NUM_BANDS 13
+
+static const struct sBand band[NUM_BANDS] =
+{
+    { "160m",       1810000,   1999999,   1836000, false, 0, false,  338,   1, 8, 8 },
+    { "80m",        3500000,   3799999,   3560000, false, 0, false,  174,   1, 8, 8 },
+    { "RWM 4996",   4996000,   4996000,   4996000, false, 0, false,  122,   1, 8, 8 },
+    { "60m UK",     5258500,   5263999,   5262000, false, 0, false,  116,   1, 8, 8 },
+    { "60m EU",     5354000,   5357999,   5355000, false, 0, false,  114,   1, 8, 8 },
+    { "40m",        7000000,   7199999,   7030000, true,  0, true,    88,   1, 8, 8 },
+    { "RWM 9996",   9996000,   9996000,   9996000, false, 1, false,   62,   1, 8, 8 },
+    { "30m",       10100000,  10150000,  10116000, true,  1, true,    60,   1, 8, 8 },
+    { "20m",       14000000,  14349999,  14060000, true,  2, true,    44,   1, 8, 8 },
+    { "17m",       18068000,  18167999,  18086000, true,  3, true,    34,   1, 8, 8 },
+    { "15m",       21000000,  21449999,  21060000, true,  3, true,    30,   1, 8, 8 },
+    { "12m",       24890000,  24989999,  24906000, false, 3, false,   26,   1, 8, 8 },
+    { "10m",       28000000,  29699999,  28060000, false, 3, false,   22,   1, 8, 8 },
+};
+
+#elif defined(SOTA7)
+#define NUM_BANDS 13
+
+static const struct sBand band[NUM_BANDS] =
+{
+    { "160m",       1810000,   1999999,   1836000, false, 0, false,  338,   1, 8, 8 },
+    { "80m",        3500000,   3799999,   3560000, false, 0, false,  174,   1, 8, 8 },
+    { "RWM 4996",   4996000,   4996000,   4996000, false, 0, false,  122,   1, 8, 8 },
+    { "60m UK",     5258500,   5263999,   5262000, false, 0, false,  116,   1, 8, 8 },
+    { "60m EU",     5354000,   5357999,   5355000, false, 0, false,  114,   1, 8, 8 },
+    { "40m",        7000000,   7199999,   7030000, true,  0, true,    88,   1, 8, 8 },
+    { "RWM 9996",   9996000,   9996000,   9996000, false, 1, false,   62,   1, 8, 8 },
+    { "30m",       10100000,  10150000,  10116000, true,  1, true,    60,   1, 8, 8 },
+    { "20m",       14000000,  14349999,  14060000, true,  2, true,    44,   1, 8, 8 },
+    { "17m",       18068000,  18167999,  18086000, true,  3, true,    34,   1, 8, 8 },
+    { "15m",       21000000,  21449999,  21060000, true,  3, true,    30,   1, 8, 8 },
+    { "12m",       24890000,  24989999,  24906000, true,  4, true,    26,   1, 8, 8 },
+    { "10m",       28000000,  29699999,  28060000, true,  4, true,    22,   1, 8, 8 },
+};
+
+#else
+#define NUM_BANDS 13
+
+static const struct sBand band[NUM_BANDS] =
+{
+    { "160m",       1810000,   1999999,   1836000, false, 0, false,  338,   1, 8, 8 },
+    { "80m",        3500000,   3799999,   3560000, true,  0, true,   174,   1, 8, 8 },
+    { "RWM 4996",   4996000,   4996000,   4996000, false, 3, false,  122,   1, 8, 8 },
+    { "60m UK",     5258500,   5263999,   5262000, true,  3, true,   116,   1, 8, 8 },
+    { "60m EU",     5354000,   5357999,   5355000, true,  3, true,   114,   1, 8, 8 },
+    { "40m",        7000000,   7199999,   7030000, true,  1, true,    88,   1, 8, 8 },
+    { "RWM 9996",   9996000,   9996000,   9996000, false, 2, false,   62,   1, 8, 8 },
+    { "30m",       10100000,  10150000,  10116000, true,  2, true,    60,   1, 8, 8 },
+    { "20m",       14000000,  14349999,  14060000, true,  4, true,    44,   1, 8, 8 },
+    { "17m",       18068000,  18167999,  18086000, false, 4, false,   34,   1, 8, 8 },
+    { "15m",       21000000,  21449999,  21060000, false, 4, false,   30,   1, 8, 8 },
+    { "12m",       24890000,  24989999,  24906000, false, 4, false,   26,   1, 8, 8 },
+    { "10m",       28000000,  29699999,  28060000, false, 4, false,   22,   1, 8, 8 },
+};
+
+#endif
+
+#endif /* BANDPLAN_H_ */
@@ -1,4 +1,5 @@
 #!/bin/sh
+./genbands.sh || exit 1
 ./convert.sh 5Band
 cd 5Band
 make all
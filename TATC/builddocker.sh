@@ -1,4 +1,5 @@
 #!/bin/sh
+./genbands.sh || exit 1
 ./convert.sh 5Band
 cd 5Band
 sed -i 's/usr/avr-gcc-12.1.0-x64-linux/g' Makefile
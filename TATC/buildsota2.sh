@@ -1,4 +1,5 @@
 #!/bin/sh
+./genbands.sh || exit 1
 ./convert.sh Sota2
 cd Sota2
 make all
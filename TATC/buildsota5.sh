@@ -1,4 +1,5 @@
 #!/bin/sh
+./genbands.sh || exit 1
 ./convert.sh SOTA5
 cd SOTA5
 make all
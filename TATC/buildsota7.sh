@@ -1,4 +1,5 @@
 #!/bin/sh
+./genbands.sh || exit 1
 ./convert.sh SOTA7
 cd SOTA7
 make all
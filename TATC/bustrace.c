@@ -0,0 +1,174 @@
+/*
+ * bustrace.c
+ *
+ * Keeps a trace of the most recent I2C bus operations and totals for
+ * each type of operation so that it can be seen what is using the bus.
+ * Operations are timed from where they are called. The status is what
+ * the bus transfers returned, or for the library's drivers the state
+ * they left the bus in. Times are recorded in timestamp ticks and
+ * converted to us when they are read.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+#include <string.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "bustrace.h"
+#include "io.h"
+
+#ifdef ENABLE_BUS_TRACE
+
+// Convert timestamp ticks to us
+#define TICKS_TO_US(ticks) (((uint32_t)(ticks) * (1000000UL/64)) / (TIMESTAMP_FREQ/64))
+
+// The counts stop at this value rather than wrapping
+#define MAX_COUNT 0xFFFF
+
+// Ring buffer of the most recent operations
+static struct sBusTraceEntry trace[BUS_TRACE_LEN];
+static uint8_t traceNext;
+static uint8_t traceCount;
+
+// Totals for each operation in ticks
+static struct
+{
+    uint16_t count;
+    uint16_t errors[NUM_I2C_STATUS];
+    uint32_t total;
+    uint16_t max;
+} counts[NUM_BUS_OPS];
+
+// The device an operation is on
+static uint8_t opAddress( enum eBusOp op )
+{
+    return (op <= busOpClocks) ? SI5351A_I2C_ADDRESS : LCD_I2C_ADDRESS;
+}
+
+// Call at the start of a traced operation and pass the result
+// to busTraceEnd()
+uint16_t busTraceStart()
+{
+    return ioReadTimestamp();
+}
+
+// Record a traced operation and the status of its bus transfers
+void busTraceEnd( enum eBusOp op, uint16_t start, enum eI2CStatus status )
+{
+    uint16_t duration = ioReadTimestamp() - start;
+
+    if( (op < NUM_BUS_OPS) && (status < NUM_I2C_STATUS) )
+    {
+        ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+        {
+            trace[traceNext].timestamp = start;
+            trace[traceNext].duration = duration;
+            trace[traceNext].address = opAddress( op );
+            trace[traceNext].op = op;
+            trace[traceNext].status = status;
+
+            traceNext = (traceNext + 1) % BUS_TRACE_LEN;
+            if( traceCount < BUS_TRACE_LEN )
+            {
+                traceCount++;
+            }
+
+            // Once the count is full stop adding to the totals
+            if( counts[op].count < MAX_COUNT )
+            {
+                counts[op].count++;
+                counts[op].total += duration;
+                if( status != i2cStatusOK )
+                {
+                    counts[op].errors[status]++;
+                }
+                if( duration > counts[op].max )
+                {
+                    counts[op].max = duration;
+                }
+            }
+        }
+    }
+}
+
+// Read a trace entry, 0 being the newest - for the stats menu
+// Returns false if there is no such entry
+bool busTraceRead( uint8_t entry, struct sBusTraceEntry *pEntry )
+{
+    bool bFound = false;
+
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        if( entry < traceCount )
+        {
+            *pEntry = trace[(traceNext + BUS_TRACE_LEN - 1 - entry) % BUS_TRACE_LEN];
+            bFound = true;
+        }
+    }
+
+    return bFound;
+}
+
+// Add an operation's totals to the counts
+static void addCounts( enum eBusOp op, struct sBusCounts *pCounts )
+{
+    uint32_t max;
+
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        pCounts->count += counts[op].count;
+        for( uint8_t status = i2cStatusOK + 1 ; status < NUM_I2C_STATUS ; status++ )
+        {
+            pCounts->errors[status] += counts[op].errors[status];
+            pCounts->failures += counts[op].errors[status];
+        }
+        pCounts->totalTime += TICKS_TO_US( counts[op].total );
+        max = TICKS_TO_US( counts[op].max );
+    }
+
+    if( max > pCounts->maxTime )
+    {
+        pCounts->maxTime = max;
+    }
+}
+
+// Read the totals for an operation - for the stats menu
+void busTraceOpCounts( enum eBusOp op, struct sBusCounts *pCounts )
+{
+    memset( pCounts, 0, sizeof( *pCounts ) );
+
+    if( op < NUM_BUS_OPS )
+    {
+        addCounts( op, pCounts );
+    }
+}
+
+// Read the totals for all operations on a device - for the stats menu
+void busTraceDeviceCounts( uint8_t address, struct sBusCounts *pCounts )
+{
+    memset( pCounts, 0, sizeof( *pCounts ) );
+
+    for( uint8_t op = 0 ; op < NUM_BUS_OPS ; op++ )
+    {
+        if( opAddress( op ) == address )
+        {
+            addCounts( op, pCounts );
+        }
+    }
+}
+
+// Clear the trace and totals - for the stats menu
+void busTraceReset()
+{
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        traceNext = 0;
+        traceCount = 0;
+        memset( counts, 0, sizeof( counts ) );
+    }
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * bustrace.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef BUSTRACE_H
+#define BUSTRACE_H
+
+#include <inttypes.h>
+
+#include "io.h"
+
+// Operations on the I2C bus that are traced
+// The oscillator ones must come first
+enum eBusOp
+{
+    busOpOscInit,       // Initialising the oscillator
+    busOpTune,          // Programming a clock frequency
+    busOpClocks,        // Turning clock outputs on or off
+    busOpDisplay,       // Updating the frequency display
+    busOpBacklight,     // Turning the LCD backlight on or off
+    NUM_BUS_OPS
+};
+
+// Devices on the bus - the oscillator and the LCD
+#define NUM_BUS_DEVICES 2
+
+// A trace entry with times in timestamp ticks
+struct sBusTraceEntry
+{
+    uint16_t timestamp;     // When it started
+    uint16_t duration;      // How long it took
+    uint8_t  address;       // I2C address of the device
+    uint8_t  op;            // enum eBusOp
+    uint8_t  status;        // enum eI2CStatus
+};
+
+// Totals for an operation or device with times in us
+// errors[i2cStatusOK] is not used
+struct sBusCounts
+{
+    uint16_t count;
+    uint16_t failures;
+    uint16_t errors[NUM_I2C_STATUS];
+    uint32_t totalTime;
+    uint32_t maxTime;
+};
+
+#ifdef ENABLE_BUS_TRACE
+
+// Call at the start of a traced operation and pass the result
+// to busTraceEnd()
+uint16_t busTraceStart();
+
+// Record a traced operation and the status of its bus transfers
+void busTraceEnd( enum eBusOp op, uint16_t start, enum eI2CStatus status );
+
+// Read a trace entry, 0 being the newest - for the stats menu
+// Returns false if there is no such entry
+bool busTraceRead( uint8_t entry, struct sBusTraceEntry *pEntry );
+
+// Read the totals for an operation - for the stats menu
+void busTraceOpCounts( enum eBusOp op, struct sBusCounts *pCounts );
+
+// Read the totals for all operations on a device - for the stats menu
+void busTraceDeviceCounts( uint8_t address, struct sBusCounts *pCounts );
+
+// Clear the trace and totals - for the stats menu
+void busTraceReset();
+
+#define BUS_TRACE_START(start)              uint16_t start = busTraceStart()
+#define BUS_TRACE_END(op, start, status)    busTraceEnd( op, start, status )
+
+#else
+
+#define BUS_TRACE_START(start)
+#define BUS_TRACE_END(op, start, status)
+
+#endif
+
+#endif //BUSTRACE_H
@@ -0,0 +1,289 @@
+/*
+ * command.c
+ *
+ * Commands on the serial port for the things the library's CAT
+ * control cannot be told to do. When the serial port is set to
+ * commands instead of CAT or WinKeyer the main loop calls
+ * commandControl() which reads and writes the serial port itself.
+ *
+ * Commands look like CAT commands - two letters, any parameters and
+ * a ';'. Letters may be in either case and spaces, carriage returns
+ * and line feeds are ignored. A command that is done is echoed back
+ * and one that is not understood or cannot be done is answered with
+ * "?;".
+ *
+ *   MSn;   Send message memory n (1 to NUM_MESSAGES), MS0; stops it
+ *
+ *   FC;    Clear the FSK symbols
+ *   FAt;   Add FSK symbols - t is one or more tone numbers 0 to F
+ *   FTo,s; Set the offset of tone 0 from the TX frequency (Hz) and the
+ *          spacing between tones (mHz)
+ *   FLn;   Set the symbol length in samples at FSK_SAMPLE_RATE
+ *   FG;    Start sending the FSK symbols
+ *   FX;    Stop sending the FSK symbols
+ *
+ *   TIhhmmss; Set the time (UTC) for the WSPR beacon
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "config.h"
+#include "command.h"
+#include "fsk.h"
+#include "message.h"
+#include "serial.h"
+#include "wspr.h"
+
+#ifndef SOTA2
+
+// A command and the function that does it
+// The function is passed the parameters with the terminating 0 in
+// place of the ';' and returns false if they are not valid
+struct sCommand
+{
+    char name[2];
+    bool (*handler)( const char *params );
+};
+
+// The command being received and its length
+static char command[COMMAND_LEN + 1];
+static uint8_t commandLen;
+
+// True if the command was too long to keep
+static bool bOverflow;
+
+// Longest number that can be read
+#define MAX_DIGITS 9
+
+// Read a number from the parameters
+// Returns a pointer to what follows it or NULL if there are no digits
+static const char *readNumber( const char *params, uint32_t *pValue )
+{
+    const char *p = params;
+    uint32_t value = 0;
+
+    while( (*p >= '0') && (*p <= '9') && ((p - params) < MAX_DIGITS) )
+    {
+        value = value * 10 + (*p++ - '0');
+    }
+    *pValue = value;
+
+    return (p != params) ? p : NULL;
+}
+
+// Read a number that is all of the parameters
+static bool readParam( const char *params, uint32_t *pValue )
+{
+    const char *end = readNumber( params, pValue );
+
+    return end && (*end == '\0');
+}
+
+// MSn; - send a message memory or stop with MS0;
+static bool commandMessage( const char *params )
+{
+    uint32_t message;
+    bool bOK = readParam( params, &message ) && (message <= NUM_MESSAGES);
+
+    if( bOK )
+    {
+        if( message == 0 )
+        {
+            messageStop();
+        }
+        else
+        {
+            messageSend( message - 1 );
+        }
+    }
+
+    return bOK;
+}
+
+// FC; - clear the FSK symbols
+static bool commandFskClear( const char *params )
+{
+    bool bOK = !*params && !fskSending();
+
+    if( bOK )
+    {
+        fskClear();
+    }
+
+    return bOK;
+}
+
+// FAt; - add FSK symbols, one hex digit for each tone
+static bool commandFskAdd( const char *params )
+{
+    bool bOK = (*params != '\0');
+
+    for( ; bOK && *params ; params++ )
+    {
+        uint8_t tone = FSK_MAX_TONES;
+
+        if( (*params >= '0') && (*params <= '9') )
+        {
+            tone = *params - '0';
+        }
+        else if( (*params >= 'A') && (*params <= 'F') )
+        {
+            tone = *params - 'A' + 10;
+        }
+
+        bOK = fskAddSymbol( tone );
+    }
+
+    return bOK;
+}
+
+// FTo,s; - set the tone offset (Hz) and spacing (mHz)
+static bool commandFskTones( const char *params )
+{
+    uint32_t offset, spacing;
+    const char *p = readNumber( params, &offset );
+    bool bOK = p && (*p++ == ',') && readParam( p, &spacing ) &&
+               (offset <= UINT16_MAX) && !fskSending();
+
+    if( bOK )
+    {
+        fskSetTones( offset, spacing );
+    }
+
+    return bOK;
+}
+
+// FLn; - set the symbol length in samples
+static bool commandFskLength( const char *params )
+{
+    uint32_t samples;
+
+    return readParam( params, &samples ) && (samples <= UINT16_MAX) && fskSetSymbolLength( samples );
+}
+
+// FG; - start sending the FSK symbols
+static bool commandFskGo( const char *params )
+{
+    return !*params && fskStart();
+}
+
+// FX; - stop sending the FSK symbols
+static bool commandFskStop( const char *params )
+{
+    bool bOK = !*params;
+
+    if( bOK )
+    {
+        fskStop();
+    }
+
+    return bOK;
+}
+
+// TIhhmmss; - set the time for the WSPR beacon
+static bool commandTime( const char *params )
+{
+    uint32_t time = 0;
+    bool bOK = (strlen( params ) == 6) && readParam( params, &time );
+    uint8_t hours = time / 10000;
+    uint8_t minutes = (time / 100) % 100;
+    uint8_t seconds = time % 100;
+
+    bOK = bOK && (hours < 24) && (minutes < 60) && (seconds < 60);
+    if( bOK )
+    {
+        wsprSetTime( hours * 3600UL + minutes * 60 + seconds );
+    }
+
+    return bOK;
+}
+
+static const struct sCommand commands[] =
+{
+    { "MS", commandMessage },
+    { "FC", commandFskClear },
+    { "FA", commandFskAdd },
+    { "FT", commandFskTones },
+    { "FL", commandFskLength },
+    { "FG", commandFskGo },
+    { "FX", commandFskStop },
+    { "TI", commandTime },
+};
+
+#define NUM_COMMANDS (sizeof( commands ) / sizeof( commands[0] ))
+
+// Send a reply
+static void reply( const char *text )
+{
+    while( *text )
+    {
+        serialTransmit( *text++ );
+    }
+}
+
+// Carry out the command that has been received
+static void doCommand()
+{
+    bool bOK = false;
+
+    command[commandLen] = '\0';
+
+    for( uint8_t i = 0 ; !bOverflow && (commandLen >= 2) && (i < NUM_COMMANDS) ; i++ )
+    {
+        if( (command[0] == commands[i].name[0]) && (command[1] == commands[i].name[1]) )
+        {
+            bOK = commands[i].handler( &command[2] );
+            break;
+        }
+    }
+
+    if( bOK )
+    {
+        reply( command );
+        reply( ";" );
+    }
+    else
+    {
+        reply( "?;" );
+    }
+
+    commandLen = 0;
+    bOverflow = false;
+}
+
+// Handle commands from the serial port and send the replies
+// Call from the main loop when the serial port is set to commands
+void commandControl()
+{
+    uint8_t data;
+
+    while( serialReceive( &data ) )
+    {
+        if( data == ';' )
+        {
+            doCommand();
+        }
+        else if( (data == ' ') || (data == '\r') || (data == '\n') )
+        {
+            // Ignore
+        }
+        else if( commandLen < COMMAND_LEN )
+        {
+            if( (data >= 'a') && (data <= 'z') )
+            {
+                data -= 'a' - 'A';
+            }
+            command[commandLen++] = data;
+        }
+        else
+        {
+            bOverflow = true;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * command.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <inttypes.h>
+
+// Handle commands from the serial port and send the replies
+// Call from the main loop when the serial port is set to commands
+void commandControl();
+
+#endif //COMMAND_H
@@ -38,6 +38,15 @@ typedef uint8_t bool;
 // and so needs to be divided down enough to get an audible frequency
 #define CLOCK_DIV 256
 
+// The RTC is a free running timestamp counter clocked by the
+// internal 32.768kHz oscillator. It wraps every 2 seconds.
+#define TIMESTAMP_FREQ 32768UL
+
+// The internal 32.768kHz oscillator is not calibrated so for FSK
+// symbols it is measured against the millisecond clock, which runs
+// from the factory calibrated main clock, over this long (ms)
+#define TIMESTAMP_CAL_TIME 8000UL
+
 // I/O definitions
 
 // Pushbuttons to use the ADC to save pins
@@ -102,6 +111,10 @@ typedef uint8_t bool;
 #define MORSE_PADDLE_DOT_PIN        5
 #define MORSE_PADDLE_DOT_PIN_CTRL   PORTA.PIN5CTRL
 
+// Both paddles are on the same port so share the pin change interrupt
+#define MORSE_PADDLE_INTFLAGS       PORTA.INTFLAGS
+#define MORSE_PADDLE_vect           PORTA_PORT_vect
+
 #define MORSE_OUTPUT_DIR_REG     VPORTA.DIR
 #define MORSE_OUTPUT_OUT_REG     VPORTA.OUT
 #define MORSE_OUTPUT_PIN         6
@@ -347,11 +360,122 @@ typedef uint8_t bool;
 // Default, minimum and maximum morse speed in wpm
 #define DEFAULT_MORSE_WPM 18
 #define MIN_MORSE_WPM 5
-#define MAX_MORSE_WPM 40
+#define MAX_MORSE_WPM 60
+
+// Keyer weighting - dash length in tenths of a dot
+// 30 is the standard 3:1 ratio
+#define KEYER_DASH_RATIO 30
 
 // Default morse keyer mode
 #define DEFAULT_KEYER_MODE 0
 
+// Size of the keyer's queue of text to send
+#define KEYER_QUEUE_LEN 16
+
+// Message memories stored in EEPROM
+// Each is up to MESSAGE_LEN characters and the serial number token
+// is replaced by the contest serial number
+#define NUM_MESSAGES            4
+#define MESSAGE_LEN            40
+#define MESSAGE_SERIAL_TOKEN   '#'
+#define DEFAULT_MESSAGE_0      "CQ TEST G4TGJ G4TGJ TEST"
+#define DEFAULT_MESSAGE_1      "5NN #"
+#define DEFAULT_MESSAGE_2      "TU G4TGJ"
+#define DEFAULT_MESSAGE_3      "AGN?"
+
+// Message repeat interval (s) for beacon use - 0 is off
+#define MAX_MESSAGE_REPEAT    300
+#define MESSAGE_REPEAT_STEP     5
+
+// WinKeyer emulation - version reported to the host, size of the text
+// buffer, the level at which XOFF is reported and the size of the
+// buffer of bytes to send to the host
+#define WINKEY_VERSION         23
+#define WINKEY_BUFFER_LEN      64
+#define WINKEY_XOFF_LEVEL      (WINKEY_BUFFER_LEN * 2 / 3)
+#define WINKEY_TX_LEN           8
+
+// WinKeyer hosts talk at 1200 baud. CAT control uses SERIAL_BAUD.
+#define WINKEY_BAUD          1200
+
+// Longest command that can be received when the serial port is set to
+// commands, not counting the ';'
+#define COMMAND_LEN           32
+
+// The serial port starts off for CAT control
+#define DEFAULT_PORT_MODE      portCAT
+
+// FSK transmission of digital mode tones loaded over the serial port
+// or by the WSPR beacon
+// Up to FSK_MAX_SYMBOLS symbols each of which is one of FSK_MAX_TONES
+// tones. Symbol lengths are in samples at FSK_SAMPLE_RATE as used by
+// WSJT-X e.g. 1920 for FT8. The default tones are FT8 spaced 6.25Hz
+// starting 1500Hz above the TX frequency.
+#define FSK_MAX_SYMBOLS         162
+#define FSK_MAX_TONES            16
+#define FSK_SAMPLE_RATE       12000
+#define FSK_DEFAULT_SYMBOL_LEN 1920
+#define FSK_DEFAULT_SPACING    6250     // mHz
+#define FSK_DEFAULT_OFFSET     1500     // Hz
+
+// WSPR beacon - default message, the offset of the lowest tone from
+// the TX frequency (Hz), the tone spacing (mHz) and symbol length
+// (samples at FSK_SAMPLE_RATE). Transmissions start this long (ms)
+// into an even minute and can be up to WSPR_START_WINDOW late.
+// There is no default callsign or locator so nothing is sent until
+// the owner has entered their own.
+#define WSPR_CALL_LEN             6
+#define WSPR_LOCATOR_LEN          4
+#define WSPR_DEFAULT_CALL        ""
+#define WSPR_DEFAULT_LOCATOR     ""
+#define WSPR_DEFAULT_POWER       37     // dBm
+#define WSPR_OFFSET            1500
+#define WSPR_SPACING           1465
+#define WSPR_SYMBOL_LEN        8192
+#define WSPR_START_TIME        1000
+#define WSPR_START_WINDOW      1000
+
+// Longest time between WSPR beacon transmissions (2 minute slots)
+#define WSPR_MAX_INTERVAL        30
+
+// Default delays when switching between RX and TX (us)
+#define DEFAULT_MUTE_DELAY      5000
+#define DEFAULT_UNMUTE_DELAY    5000
+#define DEFAULT_TX_DELAY       10000
+
+// Limits and steps for setting the switching delays in the menu (us)
+// Fine steps up to QSK_DELAY_FINE_MAX then coarse steps.
+// The mute and TX delays together must fit in 16 bits.
+#define MAX_QSK_DELAY          30000
+#define QSK_DELAY_FINE_MAX     10000
+#define QSK_DELAY_FINE_STEP      100
+#define QSK_DELAY_COARSE_STEP   1000
+
+// Semi break in hang time (ms) - default, range and step
+// Limited by the 2 second timestamp counter
+#define DEFAULT_HANG_TIME        500
+#define MIN_HANG_TIME             50
+#define MAX_HANG_TIME           1500
+#define HANG_TIME_STEP            50
+
+// Histogram of keying latencies - number of buckets and the width
+// of each bucket (us)
+#define LATENCY_NUM_BUCKETS        8
+#define LATENCY_BUCKET_WIDTH    4000
+
+// Trace I2C bus operations and keep totals of the time they take
+// Comment out to save flash and RAM. Sota2 does not have room.
+#ifndef SOTA2
+#define ENABLE_BUS_TRACE
+#endif
+
+// Number of bus operations kept in the trace
+#define BUS_TRACE_LEN              8
+
+// A paddle press within this time (us) of it being released is
+// taken to be contact bounce and not latched
+#define PADDLE_DEBOUNCE_TIME    5000
+
 // How often to update the display
 #define DISPLAY_INTERVAL 50
 
@@ -383,144 +507,9 @@ typedef uint8_t bool;
 // As we are controlling the backlight it should start off
 #define BACKLIGHT_STARTS_OFF   
 
-// For each band, what state should the LPF/PA relay be in
-// and is TX allowed on the band
-
-#ifdef SOTA2
-
-#define RELAY_STATE_40M    0        // This means relay off
-#define TX_ENABLED_40M     true
-
-#define RELAY_STATE_20M    1
-#define TX_ENABLED_20M     true
-
-#elif defined(SOTA5)
-
-#define RELAY_STATE_160M   0
-#define TX_ENABLED_160M    false
-#define QUICK_VFO_160M     false
-
-#define RELAY_STATE_80M    0
-#define TX_ENABLED_80M     false
-#define QUICK_VFO_80M      false
-
-#define RELAY_STATE_60M    0
-#define TX_ENABLED_60M     false
-#define QUICK_VFO_60M      false
-
-#define RELAY_STATE_40M    0
-#define TX_ENABLED_40M     true
-#define QUICK_VFO_40M      true
-
-#define RELAY_STATE_30M    1
-#define TX_ENABLED_30M     true
-#define QUICK_VFO_30M      true
-
-#define RELAY_STATE_20M    2
-#define TX_ENABLED_20M     true
-#define QUICK_VFO_20M      true
-
-#define RELAY_STATE_17M    3
-#define TX_ENABLED_17M     true
-#define QUICK_VFO_17M      true
-
-#define RELAY_STATE_15M    3
-#define TX_ENABLED_15M     true
-#define QUICK_VFO_15M      true
-
-#define RELAY_STATE_12M    3
-#define TX_ENABLED_12M     false
-#define QUICK_VFO_12M      false
-
-#define RELAY_STATE_10M    3
-#define TX_ENABLED_10M     false
-#define QUICK_VFO_10M      false
-
-#elif defined(SOTA7)
-
-#define RELAY_STATE_160M   0
-#define TX_ENABLED_160M    false
-#define QUICK_VFO_160M     false
-
-#define RELAY_STATE_80M    0
-#define TX_ENABLED_80M     false
-#define QUICK_VFO_80M      false
-
-#define RELAY_STATE_60M    0
-#define TX_ENABLED_60M     false
-#define QUICK_VFO_60M      false
-
-#define RELAY_STATE_40M    0
-#define TX_ENABLED_40M     true
-#define QUICK_VFO_40M      true
-
-#define RELAY_STATE_30M    1
-#define TX_ENABLED_30M     true
-#define QUICK_VFO_30M      true
-
-#define RELAY_STATE_20M    2
-#define TX_ENABLED_20M     true
-#define QUICK_VFO_20M      true
-
-#define RELAY_STATE_17M    3
-#define TX_ENABLED_17M     true
-#define QUICK_VFO_17M      true
-
-#define RELAY_STATE_15M    3
-#define TX_ENABLED_15M     true
-#define QUICK_VFO_15M      true
-
-#define RELAY_STATE_12M    4
-#define TX_ENABLED_12M     true
-#define QUICK_VFO_12M      true
-
-#define RELAY_STATE_10M    4
-#define TX_ENABLED_10M     true
-#define QUICK_VFO_10M      true
-
-#else
-
-#define RELAY_STATE_160M   0
-#define TX_ENABLED_160M    false
-#define QUICK_VFO_160M     false
-
-#define RELAY_STATE_80M    0
-#define TX_ENABLED_80M     true
-#define QUICK_VFO_80M      true
-
-#define RELAY_STATE_60M    3
-#define TX_ENABLED_60M     true
-#define QUICK_VFO_60M      true
-
-#define RELAY_STATE_40M    1
-#define TX_ENABLED_40M     true
-#define QUICK_VFO_40M      true
-
-#define RELAY_STATE_30M    2
-#define TX_ENABLED_30M     true
-#define QUICK_VFO_30M      true
-
-#define RELAY_STATE_20M    4
-#define TX_ENABLED_20M     true
-#define QUICK_VFO_20M      true
-
-#define RELAY_STATE_17M    4
-#define TX_ENABLED_17M     false
-#define QUICK_VFO_17M      false
-
-#define RELAY_STATE_15M    4
-#define TX_ENABLED_15M     false
-#define QUICK_VFO_15M      false
-
-#define RELAY_STATE_12M    4
-#define TX_ENABLED_12M     false
-#define QUICK_VFO_12M      false
-
-#define RELAY_STATE_10M    4
-#define TX_ENABLED_10M     false
-#define QUICK_VFO_10M      false
-
-#endif
+// For each band, what state the LPF/PA relay should be in, whether
+// TX is allowed and whether it is in the quick VFO menu are set in
+// bandplan.txt
 
 // Time for debouncing a button (ms)
 #define DEBOUNCE_TIME   100
@@ -0,0 +1,112 @@
+/*
+ * format.c
+ *
+ * Small fixed-width formatter for the display lines. This does the
+ * few conversions the display and menus need without pulling in
+ * sprintf and its general purpose format parser.
+ *
+ * Digits are found by subtracting powers of ten rather than dividing
+ * as 32 bit division is slow on the AVR.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+
+#include "config.h"
+#include "format.h"
+
+// Powers of ten for each digit of a 32 bit number
+#define MAX_DIGITS 10
+static const uint32_t powers[MAX_DIGITS] =
+{
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+
+// Write a number in decimal at least width characters wide padded on
+// the left with pad e.g. ' ' for "%5lu" or '0' for "%02lu"
+char *formatUnsigned( char *buf, uint32_t value, uint8_t width, char pad )
+{
+    bool bStarted = false;
+
+    for( uint8_t i = 0 ; i < MAX_DIGITS ; i++ )
+    {
+        char digit = '0';
+        uint32_t power = powers[i];
+
+        while( value >= power )
+        {
+            value -= power;
+            digit++;
+        }
+
+        // Always write the units and anything after the first
+        // non-zero digit, otherwise pad out to the width
+        if( bStarted || (digit != '0') || (i == MAX_DIGITS - 1) )
+        {
+            *buf++ = digit;
+            bStarted = true;
+        }
+        else if( (MAX_DIGITS - i) <= width )
+        {
+            *buf++ = pad;
+        }
+    }
+
+    *buf = '\0';
+    return buf;
+}
+
+// Write a string
+char *formatText( char *buf, const char *text )
+{
+    while( *text )
+    {
+        *buf++ = *text++;
+    }
+
+    *buf = '\0';
+    return buf;
+}
+
+// Write a single character
+char *formatChar( char *buf, char c )
+{
+    *buf++ = c;
+    *buf = '\0';
+    return buf;
+}
+
+// Write a frequency in Hz as kHz and tens of Hz separated by dot
+// e.g. " 7030.00" - the same as "%5lu%c%02lu"
+char *formatFrequency( char *buf, uint32_t freq, char dot )
+{
+    // Split off the Hz without a 32 bit division - each power of ten
+    // from 1000 up is worth a power three places down in kHz
+    uint32_t kHz = 0;
+    uint16_t hz;
+
+    for( uint8_t i = 0 ; i < MAX_DIGITS - 3 ; i++ )
+    {
+        while( freq >= powers[i] )
+        {
+            freq -= powers[i];
+            kHz += powers[i + 3];
+        }
+    }
+    hz = freq;
+
+    buf = formatUnsigned( buf, kHz, 5, ' ' );
+    buf = formatChar( buf, dot );
+    return formatUnsigned( buf, hz / 10, 2, '0' );
+}
+
+// Write a label, a value and its units e.g. "TX dly: 500us"
+char *formatLabel( char *buf, const char *label, uint32_t value, const char *units )
+{
+    buf = formatText( buf, label );
+    buf = formatUnsigned( buf, value, 0, ' ' );
+    return formatText( buf, units );
+}
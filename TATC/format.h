@@ -0,0 +1,36 @@
+/*
+ * format.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <inttypes.h>
+
+// Each function writes into buf, adds the terminating 0 and returns
+// a pointer to it so that calls can be chained to build up a line.
+// The caller must make sure buf is big enough.
+
+// Write a number in decimal at least width characters wide padded on
+// the left with pad e.g. ' ' for "%5lu" or '0' for "%02lu"
+// Widths of more than 10 are treated as 10
+char *formatUnsigned( char *buf, uint32_t value, uint8_t width, char pad );
+
+// Write a string
+char *formatText( char *buf, const char *text );
+
+// Write a single character
+char *formatChar( char *buf, char c );
+
+// Write a frequency in Hz as kHz and tens of Hz separated by dot
+// e.g. " 7030.00" - the same as "%5lu%c%02lu"
+char *formatFrequency( char *buf, uint32_t freq, char dot );
+
+// Write a label, a value and its units e.g. "TX dly: 500us"
+char *formatLabel( char *buf, const char *label, uint32_t value, const char *units );
+
+#endif //FORMAT_H
@@ -0,0 +1,333 @@
+/*
+ * fsk.c
+ *
+ * Transmits digital mode tone streams such as WSPR by retuning the
+ * TX clock once per symbol. The symbols, tone spacing and symbol
+ * length are loaded over the serial port or by the WSPR beacon.
+ *
+ * The TX clock runs from a PLL of its own on an integer divider. The
+ * PLL numerator for every tone is worked out to a fraction of a Hz
+ * before the transmission starts so that each symbol only writes the
+ * numerator registers that change.
+ *
+ * Symbol boundaries are timed by the RTC compare interrupt which
+ * moves on to the next symbol and schedules the one after. The RTC
+ * runs from the uncalibrated 32kHz oscillator so the symbol length is
+ * worked out from its frequency as measured against the main clock
+ * when the transmission starts. The I2C
+ * bus is shared with the LCD and a retune takes longer than a serial
+ * character so the TX clock is programmed from the main loop as soon
+ * as the interrupt says a symbol is due. How late it is gets recorded
+ * in the latency statistics.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "fsk.h"
+#include "io.h"
+#include "keyer.h"
+#include "latency.h"
+#include "main.h"
+#include "synth.h"
+
+#ifndef SOTA2
+
+// Symbols are tone numbers packed two to a byte
+static uint8_t symbols[(FSK_MAX_SYMBOLS + 1) / 2];
+static uint8_t numSymbols;
+static uint8_t maxTone;
+
+// Tone 0 offset from the TX frequency (Hz) and tone spacing (mHz)
+static uint16_t toneOffset = FSK_DEFAULT_OFFSET;
+static uint32_t toneSpacing = FSK_DEFAULT_SPACING;
+
+// Symbol length in samples at FSK_SAMPLE_RATE
+static uint16_t symbolSamples = FSK_DEFAULT_SYMBOL_LEN;
+
+// Symbol length in timestamp ticks - whole ticks and the remainder
+// in 1/FSK_SAMPLE_RATE of a tick so that there is no drift
+static uint16_t symbolTicks;
+static uint16_t symbolFraction;
+
+// TX clock PLL numerator for each tone
+static struct sSynthTone toneImage[FSK_MAX_TONES];
+
+// True while transmitting and the symbol being sent
+static volatile bool bSending;
+static volatile uint8_t currentSymbol;
+
+// Set by the symbol timer when the current symbol is due to be sent
+// and when it was due
+static volatile bool bSymbolDue;
+static volatile uint16_t symbolDueTime;
+
+// When the next symbol is due and the fraction of a tick carried over
+static uint16_t nextSymbolTime;
+static uint16_t fractionTicks;
+
+// True when the TX clock has to go back to the TX frequency once
+// we have stopped transmitting
+static bool bRestorePending;
+
+// Get a symbol from the buffer
+static uint8_t getSymbol( uint8_t symbol )
+{
+    return (symbols[symbol / 2] >> ((symbol & 1) * 4)) & 0x0F;
+}
+
+// Work out the symbol length in ticks of the timestamp counter
+// Returns false if it is too long to be compared with the 16 bit
+// timestamp, which must be less than half its range
+static bool makeSymbolTicks( uint16_t samples, uint32_t timestampFreq )
+{
+    uint32_t ticks = (uint32_t)samples * timestampFreq;
+    bool bOK = (samples > 0) && ((ticks / FSK_SAMPLE_RATE) < 0x8000);
+
+    if( bOK )
+    {
+        symbolTicks = ticks / FSK_SAMPLE_RATE;
+        symbolFraction = ticks % FSK_SAMPLE_RATE;
+    }
+
+    return bOK;
+}
+
+// Move the time of the next symbol on by one symbol length
+static void nextSymbolDue()
+{
+    nextSymbolTime += symbolTicks;
+    fractionTicks += symbolFraction;
+    if( fractionTicks >= FSK_SAMPLE_RATE )
+    {
+        fractionTicks -= FSK_SAMPLE_RATE;
+        nextSymbolTime++;
+    }
+}
+
+// Send a symbol's tone
+// Returns false if the TX clock could not be set to it
+static bool sendSymbol( uint8_t symbol )
+{
+    return setTXTone( &toneImage[getSymbol( symbol )] );
+}
+
+// Finish transmitting
+static void finish( bool bKeyUp )
+{
+    if( bSending )
+    {
+        ioStopSymbolTimer();
+        bSending = false;
+        bSymbolDue = false;
+
+        if( bKeyUp )
+        {
+            // Put the TX clock back once the PA is off
+            keyDown( false );
+            bRestorePending = true;
+        }
+        else
+        {
+            // Still transmitting so need the TX frequency now
+            restoreTXClock();
+        }
+    }
+}
+
+// Empty the symbol buffer - for serial commands and the WSPR beacon
+void fskClear()
+{
+    if( !bSending )
+    {
+        numSymbols = 0;
+        maxTone = 0;
+    }
+}
+
+// Add a symbol (tone number) to the end of the buffer - for serial
+// commands and the WSPR beacon
+// Returns false if the buffer is full, the tone is out of range or
+// a transmission is in progress
+bool fskAddSymbol( uint8_t tone )
+{
+    bool bAdded = false;
+
+    if( !bSending && (numSymbols < FSK_MAX_SYMBOLS) && (tone < FSK_MAX_TONES) )
+    {
+        if( numSymbols & 1 )
+        {
+            symbols[numSymbols / 2] |= tone << 4;
+        }
+        else
+        {
+            symbols[numSymbols / 2] = tone;
+        }
+        numSymbols++;
+
+        if( tone > maxTone )
+        {
+            maxTone = tone;
+        }
+        bAdded = true;
+    }
+
+    return bAdded;
+}
+
+// Set the offset of tone 0 from the TX frequency (Hz) and the spacing
+// between tones (mHz) - for serial commands and the WSPR beacon
+void fskSetTones( uint16_t offset, uint32_t spacing )
+{
+    if( !bSending )
+    {
+        toneOffset = offset;
+        toneSpacing = spacing;
+    }
+}
+
+// Set the length of a symbol in samples at FSK_SAMPLE_RATE - for
+// serial commands and the WSPR beacon
+// Returns false if the length is not supported
+bool fskSetSymbolLength( uint16_t samples )
+{
+    bool bSet = !bSending && makeSymbolTicks( samples, TIMESTAMP_FREQ );
+
+    if( bSet )
+    {
+        symbolSamples = samples;
+    }
+
+    return bSet;
+}
+
+// Start transmitting the symbol buffer - for serial commands and the
+// WSPR beacon
+// Returns false if there is nothing to send, the keyer is busy or the
+// TX clock cannot be set to the tones
+bool fskStart()
+{
+    bool bOK = !bSending && (numSymbols > 0) && !keyerSendingText() &&
+               makeSymbolTicks( symbolSamples, ioTimestampFreq() );
+
+    if( bOK )
+    {
+        uint64_t base = ((uint64_t)getTXFrequency() + toneOffset) * 1000;
+
+        for( uint8_t tone = 0 ; bOK && (tone <= maxTone) ; tone++ )
+        {
+            bOK = makeTXTone( base + (uint64_t)tone * toneSpacing, &toneImage[tone] );
+        }
+
+        // Set the first tone before keying down so the PA comes on
+        // at the right frequency
+        currentSymbol = 0;
+        bSymbolDue = false;
+        bRestorePending = false;
+        bOK = bOK && sendSymbol( 0 );
+
+        if( bOK )
+        {
+            keyDown( true );
+
+            nextSymbolTime = ioReadTimestamp();
+            fractionTicks = 0;
+            nextSymbolDue();
+
+            bSending = true;
+            ioStartSymbolTimer( nextSymbolTime );
+        }
+        else
+        {
+            restoreTXClock();
+        }
+    }
+
+    return bOK;
+}
+
+// Stop transmitting - for serial commands
+void fskStop()
+{
+    finish( true );
+}
+
+// Stop transmitting without keying up as the paddles or key
+// have taken over
+void fskAbort()
+{
+    finish( false );
+}
+
+// True while the symbols are being transmitted
+bool fskSending()
+{
+    return bSending;
+}
+
+// Symbol timer interrupt - moves on to the next symbol and schedules
+// the one after
+void fskTimer()
+{
+    if( bSending )
+    {
+        symbolDueTime = nextSymbolTime;
+        currentSymbol++;
+        bSymbolDue = true;
+
+        if( currentSymbol < numSymbols )
+        {
+            nextSymbolDue();
+            ioStartSymbolTimer( nextSymbolTime );
+        }
+        else
+        {
+            ioStopSymbolTimer();
+        }
+    }
+}
+
+// Send the symbol the timer says is due - call from the main loop
+void fskScan()
+{
+    if( bSending )
+    {
+        if( bSymbolDue )
+        {
+            uint8_t symbol;
+            uint16_t dueTime;
+
+            ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+            {
+                symbol = currentSymbol;
+                dueTime = symbolDueTime;
+                bSymbolDue = false;
+            }
+
+            if( symbol >= numSymbols )
+            {
+                finish( true );
+            }
+            else if( sendSymbol( symbol ) )
+            {
+                latencyRecord( latencySymbol, ioReadTimestamp() - dueTime );
+            }
+            else
+            {
+                // Better to stop than to send the wrong tone
+                finish( true );
+            }
+        }
+    }
+    else if( bRestorePending && !getTransmitting() )
+    {
+        restoreTXClock();
+        bRestorePending = false;
+    }
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * fsk.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef FSK_H
+#define FSK_H
+
+#include <inttypes.h>
+
+// Empty the symbol buffer - for serial commands and the WSPR beacon
+void fskClear();
+
+// Add a symbol (tone number) to the end of the buffer - for serial
+// commands and the WSPR beacon
+// Returns false if the buffer is full, the tone is out of range or
+// a transmission is in progress
+bool fskAddSymbol( uint8_t tone );
+
+// Set the offset of tone 0 from the TX frequency (Hz) and the spacing
+// between tones (mHz) - for serial commands and the WSPR beacon
+void fskSetTones( uint16_t offset, uint32_t spacing );
+
+// Set the length of a symbol in samples at FSK_SAMPLE_RATE - for
+// serial commands and the WSPR beacon
+// Returns false if the length is not supported
+bool fskSetSymbolLength( uint16_t samples );
+
+// Start transmitting the symbol buffer - for serial commands and the
+// WSPR beacon
+// Returns false if there is nothing to send, the keyer is busy or the
+// TX clock cannot be set to the tones
+bool fskStart();
+
+// Stop transmitting - for serial commands
+void fskStop();
+
+// Stop transmitting without keying up as the paddles or key
+// have taken over
+void fskAbort();
+
+// True while the symbols are being transmitted
+bool fskSending();
+
+// Symbol timer interrupt - moves on to the next symbol and schedules
+// the one after
+void fskTimer();
+
+// Send the symbol the timer says is due - call from the main loop
+void fskScan();
+
+#endif //FSK_H
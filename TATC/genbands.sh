@@ -0,0 +1,180 @@
+#!/bin/sh
+#
+# Generate bandplan.h from bandplan.txt
+#
+# For each band work out an even integer output divider, and the
+# R divider if one is needed, that keeps the Si5351 VCO in range
+# over the whole band. This saves having to find one at run time.
+#
+# usage: genbands.sh [input [output]]
+#
+# Exits with an error if any band cannot be covered by one divider.
+
+INPUT=${1:-bandplan.txt}
+OUTPUT=${2:-bandplan.h}
+
+# The RX clock is offset from the dial frequency by the CW tone and
+# RIT can move it by up to the range of a 16 bit offset.
+CW_FREQUENCY=$(awk '$1 == "#define" && $2 == "CW_FREQUENCY" { print $3 }' config.h)
+MARGIN=$(( ${CW_FREQUENCY:-700} + 32768 ))
+
+awk -F',' -v margin="$MARGIN" -v input="$INPUT" '
+function trim(s)
+{
+    gsub(/^[ \t]+|[ \t\r]+$/, "", s)
+    return s
+}
+
+# Find the output and R dividers for a frequency range
+# Sets outDiv and rDiv, returns 0 if there is no divider that covers it
+function dividers(lo, hi,    r, d)
+{
+    for( r = 1 ; r <= 128 ; r *= 2 )
+    {
+        # Smallest even divider that gets the VCO up to its minimum
+        d = int((VCO_MIN + lo*r - 1) / (lo*r))
+        if( d % 2 )
+        {
+            d++
+        }
+        if( d < MS_MIN )
+        {
+            d = MS_MIN
+        }
+        if( d <= MS_MAX )
+        {
+            if( d*hi*r > VCO_MAX )
+            {
+                return 0
+            }
+            outDiv = d
+            rDiv = r
+            return 1
+        }
+    }
+    return 0
+}
+
+function emit(v, ifdef,    i, f)
+{
+    if( !(v in numBands) )
+    {
+        printf("%s: no bands for %s\n", input, v) > "/dev/stderr"
+        failed = 1
+        return
+    }
+
+    printf("%s\n", ifdef)
+    printf("#define NUM_BANDS %d\n\n", numBands[v])
+    printf("static const struct sBand band[NUM_BANDS] =\n{\n")
+    for( i = 0 ; i < numBands[v] ; i++ )
+    {
+        split(row[v, i], f, SUBSEP)
+        if( v == "SOTA2" )
+        {
+            printf("    { %-11s %9s, %9s, %9s, %9s, %9s, %-6s %s, %4d, %3d, %s, %s },\n",
+                   "\"" f[1] "\",", f[2], f[3], f[4], f[5], f[6], f[7] ",", f[8], f[12], f[13], f[10], f[11])
+        }
+        else
+        {
+            printf("    { %-11s %9s, %9s, %9s, %-6s %s, %-6s %4d, %3d, %s, %s },\n",
+                   "\"" f[1] "\",", f[2], f[3], f[4], f[7] ",", f[8], f[9] ",", f[12], f[13], f[10], f[11])
+        }
+    }
+    printf("};\n\n")
+}
+
+BEGIN {
+    VCO_MIN = 600000000
+    VCO_MAX = 900000000
+    MS_MIN = 8
+    MS_MAX = 2048
+}
+
+/^[ \t]*(#|$)/ { next }
+
+{
+    if( NF != 12 )
+    {
+        printf("%s:%d: expected 12 fields\n", input, NR) > "/dev/stderr"
+        failed = 1
+        next
+    }
+
+    v = trim($1)
+    name = trim($2)
+    lo = trim($3) - margin
+    hi = trim($4) + margin
+
+    if( (trim($3)+0 > trim($5)+0) || (trim($5)+0 > trim($4)+0) )
+    {
+        printf("%s:%d: %s default is outside the band\n", input, NR, name) > "/dev/stderr"
+        failed = 1
+    }
+
+    if( (trim($11) !~ /^[2468]$/) || (trim($12) !~ /^[2468]$/) )
+    {
+        printf("%s:%d: %s drive must be 2, 4, 6 or 8 mA\n", input, NR, name) > "/dev/stderr"
+        failed = 1
+    }
+
+    if( !dividers(lo, hi) )
+    {
+        printf("%s:%d: no divider covers %s\n", input, NR, name) > "/dev/stderr"
+        failed = 1
+        next
+    }
+
+    n = numBands[v]++
+    row[v, n] = name SUBSEP trim($3) SUBSEP trim($4) SUBSEP trim($5) SUBSEP \
+                trim($6) SUBSEP trim($7) SUBSEP trim($8) SUBSEP trim($9) SUBSEP \
+                trim($10) SUBSEP trim($11) SUBSEP trim($12) SUBSEP outDiv SUBSEP rDiv
+}
+
+END {
+    if( failed )
+    {
+        exit 1
+    }
+
+    printf("/*\n * bandplan.h\n *\n")
+    printf(" * Generated by genbands.sh from %s - do not edit\n", input)
+    printf(" * The dividers keep the VCO in range up to %d Hz outside each band\n", margin)
+    printf(" */\n\n")
+    printf("#ifndef BANDPLAN_H_\n#define BANDPLAN_H_\n\n")
+    printf("// How far outside a band its dividers still keep the VCO in range\n")
+    printf("#define BAND_DIVIDER_MARGIN %d\n\n", margin)
+
+    printf("struct sBand\n{\n")
+    printf("    char     *bandName;     // Text for the menu\n")
+    printf("    uint32_t  minFreq;      // Min band frequency\n")
+    printf("    uint32_t  maxFreq;      // Max band frequency\n")
+    printf("    uint32_t  defaultFreq;  // Where to start on this band e.g. QRP calling\n")
+    printf("#ifdef SOTA2\n")
+    printf("    uint32_t  leftFreq;     // Below this frequency light the left LED\n")
+    printf("    uint32_t  rightFreq;    // Above this frequency light the right LED\n")
+    printf("#endif\n")
+    printf("    bool      bTXEnabled;   // True if TX enabled on this band\n")
+    printf("    uint8_t   relayState;   // What state to put the relays in on this band\n")
+    printf("#ifndef SOTA2\n")
+    printf("    bool      bQuickVFOMenu;// True if this band appears in the quick VFO menu\n")
+    printf("#endif\n")
+    printf("    uint16_t  outDiv;       // Even integer output divider for the band\n")
+    printf("    uint8_t   rDiv;         // R divider for the band\n")
+    printf("    uint8_t   rxDrive;      // RX clock output drive strength (mA)\n")
+    printf("    uint8_t   txDrive;      // TX clock output drive strength (mA)\n")
+    printf("};\n\n")
+
+    emit("SOTA2", "#ifdef SOTA2")
+    emit("SOTA5", "#elif defined(SOTA5)")
+    emit("SOTA7", "#elif defined(SOTA7)")
+    emit("5BAND", "#else")
+
+    printf("#endif\n\n#endif /* BANDPLAN_H_ */\n")
+
+    if( failed )
+    {
+        exit 1
+    }
+}
+' "$INPUT" > "$OUTPUT.tmp" && mv "$OUTPUT.tmp" "$OUTPUT" || { rm -f "$OUTPUT.tmp"; exit 1; }
@@ -15,7 +15,12 @@
 #include <stdlib.h>
 
 #include "config.h"
+#include "millis.h"
 #include "io.h"
+#include "main.h"
+#include "keyer.h"
+#include "fsk.h"
+#include "sequencer.h"
 
 // Functions to read and write inputs and outputs
 // This isolates the main logic from the I/O functions making it
@@ -56,6 +61,11 @@ void ioInit()
     MORSE_PADDLE_DASH_DIR_REG &= ~(1 << MORSE_PADDLE_DASH_PIN);
     MORSE_PADDLE_DASH_PIN_CTRL |= (1 << PORT_PULLUPEN_bp);
 
+    // Interrupt on both edges of the paddles so that a press is
+    // caught however long the main loop takes to get round
+    MORSE_PADDLE_DOT_PIN_CTRL |= PORT_ISC_BOTHEDGES_gc;
+    MORSE_PADDLE_DASH_PIN_CTRL |= PORT_ISC_BOTHEDGES_gc;
+
     // The three pushbuttons may be on an analogue input to save pins
 #ifdef ANALOGUE_BUTTONS
     // Disable digital input buffer
@@ -143,10 +153,407 @@ void ioInit()
     TCB1.CTRLA = TCB_CLKSEL1_bm | TCB_ENABLE_bm;
     PORTA.PIN3CTRL &= PORT_PULLUPEN_bm;
 
+    // Set up the RTC as a free running timestamp counter
+    // Have to wait for the registers to synchronise before writing
+    while( RTC.STATUS )
+    {
+    }
+    RTC.CLKSEL = RTC_CLKSEL_INT32K_gc;
+    RTC.PER = 0xFFFF;
+    RTC.CTRLA = RTC_PRESCALER_DIV1_gc | RTC_RTCEN_bm;
+
+    // Set up timer TCB0 to time the steps when switching between RX and TX
+    // It runs from the peripheral clock divided by 2 for microsecond
+    // resolution and is only enabled when a step is waiting
+    TCB0.CTRLB = TCB_CNTMODE_INT_gc;
+    TCB0.INTCTRL = TCB_CAPT_bm;
+
     /* Insert nop for synchronization*/
     _NOP();
 }
 
+// The sequence timer counts at this rate
+#define SEQUENCE_TIMER_TICKS_PER_US (F_CPU/2/1000000)
+
+// The longest time the sequence timer can count in one go (us)
+#define SEQUENCE_TIMER_MAX_US (0xFFFF/SEQUENCE_TIMER_TICKS_PER_US)
+
+// Time left for the sequence timer after the current count (us)
+static volatile uint16_t sequenceTimerRemaining;
+
+// Set the sequence timer's compare value for the next part of the time
+static void loadSequenceTimer()
+{
+    uint16_t us = sequenceTimerRemaining;
+
+    if( us > SEQUENCE_TIMER_MAX_US )
+    {
+        us = SEQUENCE_TIMER_MAX_US;
+    }
+    sequenceTimerRemaining -= us;
+
+    // Counter goes back to zero after matching so one less than the count
+    TCB0.CCMP = us * SEQUENCE_TIMER_TICKS_PER_US - 1;
+}
+
+// Start the sequence timer. txSequencerTimer() is called when
+// the supplied time (us) has passed.
+void ioStartSequenceTimer( uint16_t us )
+{
+    // Stop the timer in case it is already running
+    TCB0.CTRLA = 0;
+
+    sequenceTimerRemaining = us;
+    loadSequenceTimer();
+
+    TCB0.CNT = 0;
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+    TCB0.CTRLA = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+}
+
+// Stop the sequence timer without taking the next step
+void ioStopSequenceTimer()
+{
+    TCB0.CTRLA = 0;
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+    sequenceTimerRemaining = 0;
+}
+
+// Read the time left (us) before the sequence timer finishes
+uint16_t ioReadSequenceTimer()
+{
+    uint16_t us = 0;
+
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        if( TCB0.CTRLA & TCB_ENABLE_bm )
+        {
+            us = sequenceTimerRemaining + (TCB0.CCMP - TCB0.CNT) / SEQUENCE_TIMER_TICKS_PER_US;
+        }
+    }
+
+    return us;
+}
+
+// Read the timestamp counter - counts at TIMESTAMP_FREQ
+uint16_t ioReadTimestamp()
+{
+    uint16_t ticks;
+
+    // 16 bit read must not be interrupted
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        ticks = RTC.CNT;
+    }
+
+    return ticks;
+}
+
+#ifndef SOTA2
+// The RTC compare is shared by the keyer and FSK symbol timers
+// True if it is being used for FSK symbols
+static volatile bool bSymbolTimer;
+#endif
+
+// Set the RTC compare value and enable its interrupt
+static void startTimestampTimer( uint16_t timestamp )
+{
+    // Have to wait for the last write to synchronise
+    while( RTC.STATUS & RTC_CMPBUSY_bm )
+    {
+    }
+    RTC.CMP = timestamp;
+    RTC.INTFLAGS = RTC_CMP_bm;
+    RTC.INTCTRL = RTC_CMP_bm;
+}
+
+// Start the keyer timer. keyerTimer() is called when the timestamp
+// counter reaches the supplied value.
+// Takes over from the symbol timer as the keyer stops any FSK.
+void ioStartKeyerTimer( uint16_t timestamp )
+{
+#ifndef SOTA2
+    // Stop the interrupt before changing who it is for
+    RTC.INTCTRL = 0;
+    bSymbolTimer = false;
+#endif
+    startTimestampTimer( timestamp );
+}
+
+// Stop the keyer timer
+void ioStopKeyerTimer()
+{
+#ifndef SOTA2
+    if( !bSymbolTimer )
+#endif
+    {
+        RTC.INTCTRL = 0;
+    }
+}
+
+#ifndef SOTA2
+// Start the FSK symbol timer. fskTimer() is called when the timestamp
+// counter reaches the supplied value.
+void ioStartSymbolTimer( uint16_t timestamp )
+{
+    // Stop the interrupt before changing who it is for
+    RTC.INTCTRL = 0;
+    bSymbolTimer = true;
+    startTimestampTimer( timestamp );
+}
+
+// Stop the FSK symbol timer
+void ioStopSymbolTimer()
+{
+    if( bSymbolTimer )
+    {
+        RTC.INTCTRL = 0;
+        bSymbolTimer = false;
+    }
+}
+
+// Measurement of the timestamp counter - when it started, the ticks
+// counted since then and the counter when last read
+static bool bCalStarted;
+static uint32_t calStartMillis;
+static uint32_t calTicks;
+static uint16_t lastCalTimestamp;
+
+// The measured frequency of the timestamp counter (Hz)
+static uint32_t timestampFreq = TIMESTAMP_FREQ;
+
+// Measure the timestamp counter against the millisecond clock
+// The counter wraps every 2 seconds so the ticks are added up each
+// time round the main loop and compared with the milliseconds every
+// TIMESTAMP_CAL_TIME
+void ioCalibrateTimestamp()
+{
+    uint32_t now = millis();
+    uint16_t timestamp = ioReadTimestamp();
+
+    if( !bCalStarted )
+    {
+        bCalStarted = true;
+        calStartMillis = now;
+        calTicks = 0;
+    }
+    else
+    {
+        calTicks += (uint16_t)(timestamp - lastCalTimestamp);
+
+        if( (now - calStartMillis) >= TIMESTAMP_CAL_TIME )
+        {
+            timestampFreq = (calTicks * 1000 + (now - calStartMillis) / 2) / (now - calStartMillis);
+            calStartMillis = now;
+            calTicks = 0;
+        }
+    }
+    lastCalTimestamp = timestamp;
+}
+
+// The measured frequency of the timestamp counter (Hz)
+uint32_t ioTimestampFreq()
+{
+    return timestampFreq;
+}
+#endif
+
+// Keyer and symbol timer interrupt
+ISR(RTC_CNT_vect)
+{
+    RTC.INTFLAGS = RTC_CMP_bm;
+#ifndef SOTA2
+    if( bSymbolTimer )
+    {
+        fskTimer();
+    }
+    else
+#endif
+    {
+        keyerTimer();
+    }
+}
+
+// Sequence timer interrupt
+ISR(TCB0_INT_vect)
+{
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+
+    // Longer times take more than one count
+    if( sequenceTimerRemaining )
+    {
+        loadSequenceTimer();
+    }
+    else
+    {
+        // Finished so stop the timer and take the next step
+        TCB0.CTRLA = 0;
+        txSequencerTimer();
+    }
+}
+
+// I2C transfers on TWI0 with the bus status checked after every byte.
+// The oscillator library sets up TWI0 and uses it for single register
+// writes. These allow a block of registers to be written or read in
+// one transfer. Smart mode is turned off during a transfer so that
+// each byte received is acknowledged by command.
+// Like the library's transfers they wait until the transfer is done.
+// They are only called from the main loop, never from an interrupt,
+// so they cannot start while the library's display or oscillator
+// driver is part way through a transfer on the shared bus.
+
+// How many times to poll the TWI before giving up on a byte
+#define I2C_TIMEOUT 10000
+
+// Wait for the TWI to finish sending or receiving a byte
+static enum eI2CStatus i2cWait()
+{
+    uint16_t timeout = I2C_TIMEOUT;
+    uint8_t status;
+
+    do
+    {
+        status = TWI0.MSTATUS;
+    }
+    while( !(status & (TWI_RIF_bm | TWI_WIF_bm | TWI_ARBLOST_bm | TWI_BUSERR_bm)) && --timeout );
+
+    if( status & TWI_BUSERR_bm )
+    {
+        return i2cStatusBusError;
+    }
+    else if( status & TWI_ARBLOST_bm )
+    {
+        return i2cStatusArbLost;
+    }
+    else if( timeout == 0 )
+    {
+        return i2cStatusTimeout;
+    }
+    else if( (status & TWI_WIF_bm) && (status & TWI_RXACK_bm) )
+    {
+        // Address or data not acknowledged
+        return i2cStatusNak;
+    }
+
+    return i2cStatusOK;
+}
+
+// Send the address and register number to start a transfer
+static enum eI2CStatus i2cStart( uint8_t address, uint8_t reg )
+{
+    enum eI2CStatus status;
+
+    TWI0.MADDR = address << 1;
+    status = i2cWait();
+    if( status == i2cStatusOK )
+    {
+        TWI0.MDATA = reg;
+        status = i2cWait();
+    }
+
+    return status;
+}
+
+// End a transfer and leave the bus free for the next one
+static void i2cStop( enum eI2CStatus status )
+{
+    if( (status == i2cStatusOK) || (status == i2cStatusNak) )
+    {
+        // We still own the bus so release it
+        TWI0.MCTRLB = TWI_ACKACT_NACK_gc | TWI_MCMD_STOP_gc;
+    }
+    else
+    {
+        // Lost the bus or it is stuck so clear the errors and
+        // force the bus state back to idle
+        TWI0.MSTATUS = TWI_ARBLOST_bm | TWI_BUSERR_bm | TWI_BUSSTATE_IDLE_gc;
+    }
+}
+
+// Write a block of registers to an I2C device in one transfer
+enum eI2CStatus ioI2CWrite( uint8_t address, uint8_t reg, const uint8_t *data, uint8_t len )
+{
+    enum eI2CStatus status;
+    uint8_t mctrla = TWI0.MCTRLA;
+
+    TWI0.MCTRLA = mctrla & ~TWI_SMEN_bm;
+
+    status = i2cStart( address, reg );
+    while( (status == i2cStatusOK) && len-- )
+    {
+        TWI0.MDATA = *data++;
+        status = i2cWait();
+    }
+    i2cStop( status );
+
+    TWI0.MCTRLA = mctrla;
+
+    return status;
+}
+
+// Read a block of registers from an I2C device in one transfer
+enum eI2CStatus ioI2CRead( uint8_t address, uint8_t reg, uint8_t *data, uint8_t len )
+{
+    enum eI2CStatus status;
+    uint8_t mctrla = TWI0.MCTRLA;
+
+    TWI0.MCTRLA = mctrla & ~TWI_SMEN_bm;
+
+    status = i2cStart( address, reg );
+    if( status == i2cStatusOK )
+    {
+        // Repeated start to read - the first byte comes after the address
+        TWI0.MADDR = (address << 1) | 1;
+        status = i2cWait();
+
+        while( (status == i2cStatusOK) && len-- )
+        {
+            *data++ = TWI0.MDATA;
+            if( len )
+            {
+                // Acknowledge and receive the next byte
+                TWI0.MCTRLB = TWI_ACKACT_ACK_gc | TWI_MCMD_RECVTRANS_gc;
+                status = i2cWait();
+            }
+        }
+    }
+    i2cStop( status );
+
+    TWI0.MCTRLA = mctrla;
+
+    return status;
+}
+
+// Read the status the bus was left in by the last transfer made by the
+// library, which does not return one. An arbitration or bus error is
+// cleared so that it is not reported again for the next transfer.
+// Only a NAK of the last byte sent can be seen.
+enum eI2CStatus ioI2CLibraryStatus()
+{
+    enum eI2CStatus status = i2cStatusOK;
+    uint8_t mstatus = TWI0.MSTATUS;
+
+    if( mstatus & TWI_BUSERR_bm )
+    {
+        status = i2cStatusBusError;
+    }
+    else if( mstatus & TWI_ARBLOST_bm )
+    {
+        status = i2cStatusArbLost;
+    }
+    else if( mstatus & TWI_RXACK_bm )
+    {
+        status = i2cStatusNak;
+    }
+
+    if( (status == i2cStatusBusError) || (status == i2cStatusArbLost) )
+    {
+        TWI0.MSTATUS = TWI_ARBLOST_bm | TWI_BUSERR_bm | TWI_BUSSTATE_IDLE_gc;
+    }
+
+    return status;
+}
+
 void ioReadRotary( bool *pbA, bool *pbB, bool *pbSw )
 {
     *pbA  = !(ROTARY_ENCODER_A_IN_REG & (1 << ROTARY_ENCODER_A_PIN));
@@ -187,15 +594,96 @@ return false;
 #endif
 }
 
+// Paddle presses latched by the pin change interrupt until read
+static volatile bool bDotLatched, bDashLatched;
+
+// Timestamps of the last paddle releases for debouncing
+static uint16_t dotReleaseTimestamp, dashReleaseTimestamp;
+
+// Timestamp of the last paddle press and whether it has been read yet
+static volatile uint16_t paddleTimestamp;
+static volatile bool bPaddleTimestampValid;
+
 // Read the morse dot and dash paddles
+// A paddle counts as pressed if it is down now or has been pressed
+// since the last read
 bool ioReadDotPaddle()
 {
-    return !(MORSE_PADDLE_DOT_IN_REG & (1 << MORSE_PADDLE_DOT_PIN));
+    bool bPressed = !(MORSE_PADDLE_DOT_IN_REG & (1 << MORSE_PADDLE_DOT_PIN)) || bDotLatched;
+    bDotLatched = false;
+    return bPressed;
 }
 
 bool ioReadDashPaddle()
 {
-    return !(MORSE_PADDLE_DASH_IN_REG & (1 << MORSE_PADDLE_DASH_PIN));
+    bool bPressed = !(MORSE_PADDLE_DASH_IN_REG & (1 << MORSE_PADDLE_DASH_PIN)) || bDashLatched;
+    bDashLatched = false;
+    return bPressed;
+}
+
+// Read the timestamp of the last paddle press
+// Returns false if there has not been a press since the last read
+bool ioReadPaddleTimestamp( uint16_t *pTimestamp )
+{
+    bool bValid;
+
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        bValid = bPaddleTimestampValid;
+        *pTimestamp = paddleTimestamp;
+        bPaddleTimestampValid = false;
+    }
+
+    return bValid;
+}
+
+// Time after a release during which a press is ignored (timestamp ticks)
+#define PADDLE_DEBOUNCE_TICKS ((uint16_t)((uint32_t)PADDLE_DEBOUNCE_TIME * TIMESTAMP_FREQ / 1000000UL))
+
+// Paddle pin change interrupt
+// Latches presses so the keyer sees them even if the paddle has been
+// released before it next scans
+ISR(MORSE_PADDLE_vect)
+{
+    uint8_t flags = MORSE_PADDLE_INTFLAGS;
+    uint16_t now = RTC.CNT;
+
+    if( flags & (1 << MORSE_PADDLE_DOT_PIN) )
+    {
+        if( MORSE_PADDLE_DOT_IN_REG & (1 << MORSE_PADDLE_DOT_PIN) )
+        {
+            dotReleaseTimestamp = now;
+        }
+        else if( (uint16_t)(now - dotReleaseTimestamp) > PADDLE_DEBOUNCE_TICKS )
+        {
+            bDotLatched = true;
+            paddleTimestamp = now;
+            bPaddleTimestampValid = true;
+        }
+    }
+
+    if( flags & (1 << MORSE_PADDLE_DASH_PIN) )
+    {
+        if( MORSE_PADDLE_DASH_IN_REG & (1 << MORSE_PADDLE_DASH_PIN) )
+        {
+            dashReleaseTimestamp = now;
+        }
+        else if( (uint16_t)(now - dashReleaseTimestamp) > PADDLE_DEBOUNCE_TICKS )
+        {
+            bDashLatched = true;
+            paddleTimestamp = now;
+            bPaddleTimestampValid = true;
+        }
+    }
+
+    // Clear the flags by writing ones
+    MORSE_PADDLE_INTFLAGS = flags & ((1 << MORSE_PADDLE_DOT_PIN) | (1 << MORSE_PADDLE_DASH_PIN));
+
+    // Start the keyer straight away if it is idle
+    if( bDotLatched || bDashLatched )
+    {
+        keyerPaddlePressed();
+    }
 }
 
 // Set the morse output high or low
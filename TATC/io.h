@@ -17,6 +17,10 @@ void ioInit();
 bool ioReadDotPaddle();
 bool ioReadDashPaddle();
 
+// Read the timestamp of the last paddle press
+// Returns false if there has not been a press since the last read
+bool ioReadPaddleTimestamp( uint16_t *pTimestamp );
+
 // Read the rotary control and switch
 void ioReadRotary( bool *pbA, bool *pbB, bool *pbSw );
 
@@ -39,6 +43,63 @@ void ioWriteSidetoneOff();
 // Switch a band relay output on or off
 void ioWriteBandRelay( uint8_t relay, bool bOn );
 
+// Start the sequence timer. txSequencerTimer() is called when
+// the supplied time (us) has passed.
+void ioStartSequenceTimer( uint16_t us );
+
+// Stop the sequence timer without taking the next step
+void ioStopSequenceTimer();
+
+// Read the time left (us) before the sequence timer finishes
+uint16_t ioReadSequenceTimer();
+
+// Read the timestamp counter - counts at TIMESTAMP_FREQ
+uint16_t ioReadTimestamp();
+
+// Start the keyer timer. keyerTimer() is called when the timestamp
+// counter reaches the supplied value.
+void ioStartKeyerTimer( uint16_t timestamp );
+
+// Stop the keyer timer
+void ioStopKeyerTimer();
+
+#ifndef SOTA2
+// Start the FSK symbol timer. fskTimer() is called when the timestamp
+// counter reaches the supplied value.
+void ioStartSymbolTimer( uint16_t timestamp );
+
+// Stop the FSK symbol timer
+void ioStopSymbolTimer();
+
+// Measure the timestamp counter against the millisecond clock - call
+// from the main loop at least once a second
+void ioCalibrateTimestamp();
+
+// The measured frequency of the timestamp counter (Hz)
+// TIMESTAMP_FREQ until it has been measured
+uint32_t ioTimestampFreq();
+#endif
+
+// Result of an I2C transfer
+enum eI2CStatus
+{
+    i2cStatusOK,
+    i2cStatusNak,           // The device did not acknowledge
+    i2cStatusArbLost,       // Another master took the bus
+    i2cStatusBusError,      // Illegal start or stop on the bus
+    i2cStatusTimeout,       // The bus did not respond
+    NUM_I2C_STATUS
+};
+
+// Write a block of registers to an I2C device in one transfer
+enum eI2CStatus ioI2CWrite( uint8_t address, uint8_t reg, const uint8_t *data, uint8_t len );
+
+// Read a block of registers from an I2C device in one transfer
+enum eI2CStatus ioI2CRead( uint8_t address, uint8_t reg, uint8_t *data, uint8_t len );
+
+// Read the status the bus was left in by the library's last transfer
+enum eI2CStatus ioI2CLibraryStatus();
+
 #ifdef SOTA2
 // Turn LEDs on or off
 void ioWriteRightLED( bool bOn );
@@ -0,0 +1,490 @@
+/*
+ * keyer.c
+ *
+ * Iambic A/B and Ultimatic keyer.
+ * The elements and the spaces between them are timed by the keyer
+ * timer interrupt so that their lengths do not depend on how long the
+ * main loop takes to get round. The speed and keyer mode are still
+ * set in the morse module, which also handles the straight key.
+ *
+ * Text put in the queue is also sent e.g. from the message memories.
+ * Pressing a paddle stops the text.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+#include <ctype.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "io.h"
+#include "main.h"
+#include "morse.h"
+#include "keyer.h"
+
+// Length of a dot in timestamp ticks
+// PARIS is 50 dot lengths so a dot is 60/(50*wpm) seconds
+#define DOT_TICKS(wpm) ((uint16_t)((TIMESTAMP_FREQ * 6UL + (wpm) * 5 / 2) / ((wpm) * 5)))
+
+// Length of a dash in timestamp ticks with the weighting applied
+#define DASH_TICKS(wpm) ((uint16_t)((TIMESTAMP_FREQ * 6UL * KEYER_DASH_RATIO + (wpm) * 25) / ((wpm) * 50)))
+
+// Timings for each wpm, all in timestamp ticks
+struct sKeyerTiming
+{
+    uint16_t dot;
+    uint16_t dash;
+    uint16_t elementGap;
+    uint16_t charGap;
+};
+
+#define KEYER_TIMING(wpm) { DOT_TICKS(wpm), DASH_TICKS(wpm), DOT_TICKS(wpm), 3 * DOT_TICKS(wpm) }
+
+#if (MIN_MORSE_WPM != 5) || (MAX_MORSE_WPM != 60)
+#error "keyerTiming[] must have an entry for each wpm from MIN_MORSE_WPM to MAX_MORSE_WPM"
+#endif
+
+// Worked out at compile time so that changing speed is just a lookup
+// Const data is in flash on the ATtiny 1-series
+static const struct sKeyerTiming keyerTiming[MAX_MORSE_WPM - MIN_MORSE_WPM + 1] =
+{
+    KEYER_TIMING(5),  KEYER_TIMING(6),  KEYER_TIMING(7),  KEYER_TIMING(8),  KEYER_TIMING(9),
+    KEYER_TIMING(10), KEYER_TIMING(11), KEYER_TIMING(12), KEYER_TIMING(13), KEYER_TIMING(14),
+    KEYER_TIMING(15), KEYER_TIMING(16), KEYER_TIMING(17), KEYER_TIMING(18), KEYER_TIMING(19),
+    KEYER_TIMING(20), KEYER_TIMING(21), KEYER_TIMING(22), KEYER_TIMING(23), KEYER_TIMING(24),
+    KEYER_TIMING(25), KEYER_TIMING(26), KEYER_TIMING(27), KEYER_TIMING(28), KEYER_TIMING(29),
+    KEYER_TIMING(30), KEYER_TIMING(31), KEYER_TIMING(32), KEYER_TIMING(33), KEYER_TIMING(34),
+    KEYER_TIMING(35), KEYER_TIMING(36), KEYER_TIMING(37), KEYER_TIMING(38), KEYER_TIMING(39),
+    KEYER_TIMING(40), KEYER_TIMING(41), KEYER_TIMING(42), KEYER_TIMING(43), KEYER_TIMING(44),
+    KEYER_TIMING(45), KEYER_TIMING(46), KEYER_TIMING(47), KEYER_TIMING(48), KEYER_TIMING(49),
+    KEYER_TIMING(50), KEYER_TIMING(51), KEYER_TIMING(52), KEYER_TIMING(53), KEYER_TIMING(54),
+    KEYER_TIMING(55), KEYER_TIMING(56), KEYER_TIMING(57), KEYER_TIMING(58), KEYER_TIMING(59),
+    KEYER_TIMING(60),
+};
+
+// Morse code for each character from ' ' to 'Z'
+// Sent from bit 0 with 0 for a dot and 1 for a dash. The highest bit
+// set marks the end. 0 means no morse for the character.
+#define FIRST_MORSE_CHAR ' '
+#define LAST_MORSE_CHAR  'Z'
+static const uint8_t morseCode[LAST_MORSE_CHAR - FIRST_MORSE_CHAR + 1] =
+{
+    0x00, 0x75, 0x52, 0x00, 0x00, 0x00, 0x22, 0x5E,  // ' ' '!' '"' '#' '$' '%' '&' '''
+    0x2D, 0x6D, 0x00, 0x2A, 0x73, 0x61, 0x6A, 0x29,  // '(' ')' '*' '+' ',' '-' '.' '/'
+    0x3F, 0x3E, 0x3C, 0x38, 0x30, 0x20, 0x21, 0x23,  // '0' '1' '2' '3' '4' '5' '6' '7'
+    0x27, 0x2F, 0x47, 0x55, 0x00, 0x31, 0x00, 0x4C,  // '8' '9' ':' ';' '<' '=' '>' '?'
+    0x56, 0x06, 0x11, 0x15, 0x09, 0x02, 0x14, 0x0B,  // '@' 'A' 'B' 'C' 'D' 'E' 'F' 'G'
+    0x10, 0x04, 0x1E, 0x0D, 0x12, 0x07, 0x05, 0x0F,  // 'H' 'I' 'J' 'K' 'L' 'M' 'N' 'O'
+    0x16, 0x1B, 0x0A, 0x08, 0x03, 0x0C, 0x18, 0x0E,  // 'P' 'Q' 'R' 'S' 'T' 'U' 'V' 'W'
+    0x19, 0x1D, 0x13,                                // 'X' 'Y' 'Z'
+};
+
+static volatile enum eKeyerState
+{
+    keyerIdle,          // Not sending
+    keyerMark,          // Sending a dot or dash
+    keyerSpace,         // Space after a dot or dash
+    keyerCharSpace      // Rest of the space after a character or word
+} keyerState;
+
+// Queue of text to send
+static volatile char keyerQueue[KEYER_QUEUE_LEN];
+static volatile uint8_t queueHead, queueTail, queueCount;
+
+// True when sending text from the queue rather than from the paddles
+static volatile bool bSendingText;
+
+// The rest of the character being sent from the queue
+static uint8_t textCode;
+
+// Goes up by one for each paddle press
+static volatile uint8_t paddlePresses;
+
+// Speed and keyer mode - only changed when idle
+static const struct sKeyerTiming *pTiming = &keyerTiming[DEFAULT_MORSE_WPM - MIN_MORSE_WPM];
+static enum eMorseKeyerMode keyerMode;
+
+// True when the keyer is in use i.e. not in straight key mode
+static volatile bool bKeyerEnabled;
+
+// The timestamp at which the current element or space ends
+static uint16_t nextTimestamp;
+
+// The last element sent
+static bool bLastDash;
+
+// Squeeze memory for Iambic B
+static bool bDotMemory, bDashMemory;
+
+// The paddle states at the last sample and which was pressed last
+// for Ultimatic
+static bool bDotWasPressed, bDashWasPressed;
+static bool bLastPressedDash;
+
+// Note which paddle was pressed last for Ultimatic
+static void notePaddle( bool bDash, bool bPressed, bool *pbWasPressed )
+{
+    if( bPressed && !*pbWasPressed )
+    {
+        bLastPressedDash = bDash;
+    }
+    *pbWasPressed = bPressed;
+}
+
+// Read one paddle and keep track of which one was pressed last
+// Reading a paddle clears its latched press
+static bool samplePaddle( bool bDash )
+{
+    bool bPressed;
+
+    if( bDash )
+    {
+        bPressed = ioReadDashPaddle();
+        notePaddle( true, bPressed, &bDashWasPressed );
+    }
+    else
+    {
+        bPressed = ioReadDotPaddle();
+        notePaddle( false, bPressed, &bDotWasPressed );
+    }
+
+    return bPressed;
+}
+
+// Read the paddles and keep track of which one was pressed last
+static void samplePaddles( bool *pbDot, bool *pbDash )
+{
+    *pbDot = samplePaddle( false );
+    *pbDash = samplePaddle( true );
+}
+
+// Start sending a dot or dash
+// Times from the end of the last space so that errors do not add up
+static void sendElement( bool bDash )
+{
+    bLastDash = bDash;
+    if( bDash )
+    {
+        bDashMemory = false;
+    }
+    else
+    {
+        bDotMemory = false;
+    }
+
+    keyerState = keyerMark;
+    keyDownInterrupt( true );
+
+    nextTimestamp += bDash ? pTiming->dash : pTiming->dot;
+    ioStartKeyerTimer( nextTimestamp );
+}
+
+// Send the next element of the character from the queue
+static void sendTextElement()
+{
+    bool bDash = textCode & 1;
+    textCode >>= 1;
+    sendElement( bDash );
+}
+
+// Send the next character from the queue
+// Spaces are a longer gap between words
+// Returns false if there is nothing left to send
+static bool sendTextChar()
+{
+    bool bSent = false;
+    char c;
+
+    while( !bSent && queueCount )
+    {
+        c = keyerQueue[queueTail];
+        queueTail = (queueTail + 1) % KEYER_QUEUE_LEN;
+        queueCount--;
+
+        c = toupper( c );
+        if( c == ' ' )
+        {
+            // Already had the gap after the last character so only
+            // need the rest of the word gap
+            keyerState = keyerCharSpace;
+            nextTimestamp += pTiming->charGap + pTiming->elementGap;
+            ioStartKeyerTimer( nextTimestamp );
+            bSent = true;
+        }
+        else if( (c >= FIRST_MORSE_CHAR) && (c <= LAST_MORSE_CHAR) && morseCode[c - FIRST_MORSE_CHAR] )
+        {
+            textCode = morseCode[c - FIRST_MORSE_CHAR];
+            sendTextElement();
+            bSent = true;
+        }
+    }
+
+    return bSent;
+}
+
+// Decide what to send next from the paddles
+// Returns to idle if nothing is to be sent
+static void sendNext( bool bDot, bool bDash )
+{
+    if( bDot && bDash )
+    {
+        // Squeezed - Ultimatic sends the last paddle pressed and
+        // iambic alternates
+        if( keyerMode == morseKeyerUltimatic )
+        {
+            sendElement( bLastPressedDash );
+        }
+        else
+        {
+            sendElement( (keyerState == keyerIdle) ? false : !bLastDash );
+
+            // Iambic B sends the other element even if the paddles
+            // are let go before this one ends
+            if( keyerMode == morseKeyerIambicB )
+            {
+                if( bLastDash )
+                {
+                    bDotMemory = true;
+                }
+                else
+                {
+                    bDashMemory = true;
+                }
+            }
+        }
+    }
+    else if( bDot )
+    {
+        sendElement( false );
+    }
+    else if( bDash )
+    {
+        sendElement( true );
+    }
+    else
+    {
+        keyerState = keyerIdle;
+        ioStopKeyerTimer();
+    }
+}
+
+// Start sending if idle and a paddle is pressed
+// Must be called with interrupts disabled
+static void startKeyer()
+{
+    bool bDot, bDash;
+
+    if( bKeyerEnabled && (keyerState == keyerIdle) )
+    {
+        samplePaddles( &bDot, &bDash );
+        if( bDot || bDash )
+        {
+            nextTimestamp = ioReadTimestamp();
+            sendNext( bDot, bDash );
+        }
+    }
+}
+
+// Look for the paddles being pressed and start sending if they are
+// Also starts sending any text in the queue
+// Picks up any change of speed or keyer mode when idle
+// Returns true if the keyer is sending from the paddles
+bool keyerScanPaddles()
+{
+    bool bActive;
+    uint8_t wpm = morseGetWpm();
+
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        if( keyerState == keyerIdle )
+        {
+            // A wpm of 0 is straight key mode which the morse module handles
+            bKeyerEnabled = (wpm != 0);
+            if( bKeyerEnabled )
+            {
+                if( wpm < MIN_MORSE_WPM )
+                {
+                    wpm = MIN_MORSE_WPM;
+                }
+                else if( wpm > MAX_MORSE_WPM )
+                {
+                    wpm = MAX_MORSE_WPM;
+                }
+                pTiming = &keyerTiming[wpm - MIN_MORSE_WPM];
+                keyerMode = morseGetKeyerMode();
+            }
+        }
+
+        // Catches a paddle that was already held
+        startKeyer();
+
+        // Nothing from the paddles so send any queued text
+        if( bKeyerEnabled && (keyerState == keyerIdle) && queueCount )
+        {
+            nextTimestamp = ioReadTimestamp();
+            bSendingText = sendTextChar();
+        }
+        else if( !bKeyerEnabled )
+        {
+            // Cannot send text in straight key mode
+            queueCount = queueHead = queueTail = 0;
+        }
+
+        bActive = (keyerState != keyerIdle) && !bSendingText;
+    }
+
+    return bActive;
+}
+
+// Called from the paddle interrupt when a paddle is pressed
+void keyerPaddlePressed()
+{
+    // A paddle stops any text
+    // Finishes the current element then goes over to the paddles
+    if( bSendingText )
+    {
+        queueCount = queueHead = queueTail = 0;
+        textCode = 1;
+        bSendingText = false;
+    }
+    paddlePresses++;
+
+    startKeyer();
+}
+
+// Add a character to the queue of text to send
+// Returns false if the queue is full
+bool keyerQueueChar( char c )
+{
+    bool bQueued = false;
+
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        if( queueCount < KEYER_QUEUE_LEN )
+        {
+            keyerQueue[queueHead] = c;
+            queueHead = (queueHead + 1) % KEYER_QUEUE_LEN;
+            queueCount++;
+            bQueued = true;
+        }
+    }
+
+    return bQueued;
+}
+
+// The space left in the queue
+uint8_t keyerQueueSpace()
+{
+    return KEYER_QUEUE_LEN - queueCount;
+}
+
+// Throw away the queued text
+// The character being sent stops after its current element
+void keyerClearQueue()
+{
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        queueCount = queueHead = queueTail = 0;
+        if( bSendingText )
+        {
+            textCode = 1;
+        }
+    }
+}
+
+// True if there is text queued or being sent
+bool keyerSendingText()
+{
+    return bSendingText || queueCount;
+}
+
+// Count of paddle presses - it wraps so compare it with an earlier
+// count to see if a paddle has been pressed since. Each user of the
+// keyer keeps its own copy so that they do not miss each other's.
+uint8_t keyerPaddlePresses()
+{
+    return paddlePresses;
+}
+
+// Called from the keyer timer interrupt at the end of each element and space
+void keyerTimer()
+{
+    bool bDot, bDash;
+
+    switch( keyerState )
+    {
+        case keyerMark:
+            keyDownInterrupt( false );
+
+            keyerState = keyerSpace;
+            nextTimestamp += pTiming->elementGap;
+            ioStartKeyerTimer( nextTimestamp );
+
+            if( bSendingText )
+            {
+                break;
+            }
+
+            // Remember the other paddle being pressed during the element,
+            // even if it has been let go, so a quick tap is not lost.
+            // The paddle just sent is not read so that a press latched
+            // during the element is still there at the end of the space.
+            // Ultimatic only remembers it if it is the last one pressed.
+            if( samplePaddle( !bLastDash ) &&
+                ((keyerMode != morseKeyerUltimatic) || (bLastPressedDash != bLastDash)) )
+            {
+                if( bLastDash )
+                {
+                    bDotMemory = true;
+                }
+                else
+                {
+                    bDashMemory = true;
+                }
+            }
+            break;
+
+        case keyerSpace:
+            if( bSendingText )
+            {
+                if( textCode > 1 )
+                {
+                    // More of the character to send
+                    sendTextElement();
+                }
+                else
+                {
+                    // End of the character so make up the gap
+                    keyerState = keyerCharSpace;
+                    nextTimestamp += pTiming->charGap - pTiming->elementGap;
+                    ioStartKeyerTimer( nextTimestamp );
+                }
+            }
+            else
+            {
+                samplePaddles( &bDot, &bDash );
+                sendNext( bDot || bDotMemory, bDash || bDashMemory );
+            }
+            break;
+
+        case keyerCharSpace:
+            if( bSendingText )
+            {
+                bSendingText = sendTextChar();
+            }
+
+            // Finished the text or stopped by a paddle
+            if( !bSendingText )
+            {
+                samplePaddles( &bDot, &bDash );
+                sendNext( bDot, bDash );
+            }
+            break;
+
+        default:
+            ioStopKeyerTimer();
+            break;
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ * keyer.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef KEYER_H
+#define KEYER_H
+
+#include <inttypes.h>
+
+// Look for the paddles being pressed and start sending if they are
+// Also starts sending any text in the queue
+// Picks up any change of speed or keyer mode when idle
+// Returns true if the keyer is sending from the paddles
+bool keyerScanPaddles();
+
+// Add a character to the queue of text to send
+// Returns false if the queue is full
+bool keyerQueueChar( char c );
+
+// The space left in the queue
+uint8_t keyerQueueSpace();
+
+// Throw away the queued text
+// The character being sent stops after its current element
+void keyerClearQueue();
+
+// True if there is text queued or being sent
+bool keyerSendingText();
+
+// Count of paddle presses - it wraps so compare it with an earlier
+// count to see if a paddle has been pressed since. Each user of the
+// keyer keeps its own copy so that they do not miss each other's.
+uint8_t keyerPaddlePresses();
+
+// Called from the paddle interrupt when a paddle is pressed
+void keyerPaddlePressed();
+
+// Called from the keyer timer interrupt at the end of each element and space
+void keyerTimer();
+
+#endif //KEYER_H
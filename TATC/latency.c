@@ -0,0 +1,113 @@
+/*
+ * latency.c
+ *
+ * Keeps statistics of how long each stage of keying takes
+ * so that the effect of the mute and TX delays can be measured.
+ * Times are recorded in timestamp ticks and converted to us
+ * when read.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+#include <string.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "latency.h"
+
+#ifndef SOTA2
+
+// Convert timestamp ticks to us
+// Exact for the 32768Hz timestamp as 1000000/32768 = 15625/512
+#define TICKS_TO_US(ticks) (((uint32_t)(ticks) * (1000000UL/64)) / (TIMESTAMP_FREQ/64))
+
+// Width of a histogram bucket in timestamp ticks
+#define LATENCY_BUCKET_TICKS ((uint16_t)((uint32_t)LATENCY_BUCKET_WIDTH * TIMESTAMP_FREQ / 1000000UL))
+
+// The counts stop at this value rather than wrapping
+#define MAX_COUNT 0xFFFF
+
+static struct
+{
+    uint16_t count;
+    uint16_t min;
+    uint16_t max;
+    uint32_t total;
+    uint16_t histogram[LATENCY_NUM_BUCKETS];
+} stats[NUM_LATENCY_STAGES];
+
+// Record the time taken (timestamp ticks) for a stage
+// May be called from an interrupt
+void latencyRecord( enum eLatencyStage stage, uint16_t ticks )
+{
+    uint16_t bucket;
+
+    if( stage < NUM_LATENCY_STAGES )
+    {
+        bucket = ticks / LATENCY_BUCKET_TICKS;
+        if( bucket >= LATENCY_NUM_BUCKETS )
+        {
+            bucket = LATENCY_NUM_BUCKETS - 1;
+        }
+
+        ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+        {
+            // Once the count is full stop adding to the totals
+            // so that the mean stays correct
+            if( stats[stage].count < MAX_COUNT )
+            {
+                if( stats[stage].count == 0 || ticks < stats[stage].min )
+                {
+                    stats[stage].min = ticks;
+                }
+                if( ticks > stats[stage].max )
+                {
+                    stats[stage].max = ticks;
+                }
+                stats[stage].count++;
+                stats[stage].total += ticks;
+                stats[stage].histogram[bucket]++;
+            }
+        }
+    }
+}
+
+// Read the statistics for a stage - for the stats menu
+void latencyRead( enum eLatencyStage stage, struct sLatencyStats *pStats )
+{
+    uint32_t total = 0;
+
+    memset( pStats, 0, sizeof( *pStats ) );
+
+    if( stage < NUM_LATENCY_STAGES )
+    {
+        ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+        {
+            pStats->count = stats[stage].count;
+            pStats->min = stats[stage].min;
+            pStats->max = stats[stage].max;
+            total = stats[stage].total;
+            memcpy( pStats->histogram, stats[stage].histogram, sizeof( pStats->histogram ) );
+        }
+
+        pStats->min = TICKS_TO_US( pStats->min );
+        pStats->max = TICKS_TO_US( pStats->max );
+        if( pStats->count )
+        {
+            pStats->mean = TICKS_TO_US( total / pStats->count );
+        }
+    }
+}
+
+// Clear all the statistics - for the stats menu
+void latencyReset()
+{
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        memset( stats, 0, sizeof( stats ) );
+    }
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * latency.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <inttypes.h>
+
+// Stages of keying that are timed
+enum eLatencyStage
+{
+    latencyPaddle,          // Paddle press to the keyer keying down
+    latencyClocks,          // Key down to the RX and TX clocks being swapped
+    latencyClockSwitch,     // Time taken to swap the clocks over I2C
+    latencyPA,              // Key down to the PA going on
+    latencySymbol,          // FSK symbol boundary to the TX clock being retuned
+    NUM_LATENCY_STAGES
+};
+
+// Statistics for a stage with times in us
+// The last histogram bucket also counts anything longer
+struct sLatencyStats
+{
+    uint16_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+    uint16_t histogram[LATENCY_NUM_BUCKETS];
+};
+
+#ifdef SOTA2
+// The SOTA2 has no menu to show them on so they are not kept
+#define latencyRecord( stage, ticks ) ((void)(ticks))
+#else
+// Record the time taken (timestamp ticks) for a stage
+void latencyRecord( enum eLatencyStage stage, uint16_t ticks );
+
+// Read the statistics for a stage - for the stats menu
+void latencyRead( enum eLatencyStage stage, struct sLatencyStats *pStats );
+
+// Clear all the statistics - for the stats menu
+void latencyReset();
+#endif
+
+#endif //LATENCY_H
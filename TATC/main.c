@@ -8,9 +8,9 @@
 //#define DISABLE_LCD
 
 #include <util/delay_basic.h>
+#include <util/atomic.h>
 
 #include <string.h>
-#include <stdio.h>
 #include <stdlib.h>
 
 #include "config.h"
@@ -23,14 +23,27 @@
 #include "lcd.h"
 #include "morse.h"
 #include "cat.h"
+#include "serial.h"
 #include "rotary.h"
 #include "pushbutton.h"
+#include "latency.h"
+#include "keyer.h"
+#include "message.h"
+#include "winkey.h"
+#include "command.h"
+#include "fsk.h"
+#include "wspr.h"
+#include "bustrace.h"
+#include "format.h"
+#include "sequencer.h"
+#include "synth.h"
 
 #ifndef SOTA2
 // Menu functions
 static bool menuVFOBand( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuVFOMode( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuBreakIn( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
+static bool menuHangTime( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuTestRXMute( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuSidetone( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuRXClock( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
@@ -39,9 +52,16 @@ static bool menuMuteDelay( bool bCW, bool bCCW, bool bShortPress, bool bLongPres
 static bool menuTXDelay( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuTXClock( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuTXOut( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
+static bool menuStats( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuXtalFreq( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuKeyerMode( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 static bool menuBacklight( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
+static bool menuMessageRepeat( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
+static bool menuSerial( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
+static bool menuSerialPort( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
+static bool menuWsprBeacon( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
+static bool menuWsprMessage( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
+static bool menuEditMessage( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight );
 
 // Menu structure arrays
 
@@ -59,11 +79,12 @@ static const struct sMenuItem vfoMenu[NUM_VFO_MENUS] =
     { "VFO Mode",       menuVFOMode },
 };
 
-#define NUM_TEST_MENUS 10
+#define NUM_TEST_MENUS 12
 static const struct sMenuItem testMenu[NUM_TEST_MENUS] =
 {
     { "",               NULL },
     { "Break in",       menuBreakIn },
+    { "Hang time",      menuHangTime },
     { "Test RX Mute",   menuTestRXMute },
     { "Sidetone",       menuSidetone },
     { "RX Clock",       menuRXClock },
@@ -72,15 +93,22 @@ static const struct sMenuItem testMenu[NUM_TEST_MENUS] =
     { "TX delay",       menuTXDelay },
     { "TX Clock",       menuTXClock },
     { "TX Out",         menuTXOut },
+    { "Stats",          menuStats },
 };
 
-#define NUM_CONFIG_MENUS 4
+#define NUM_CONFIG_MENUS 10
 static const struct sMenuItem configMenu[NUM_CONFIG_MENUS] =
 {
     { "",               NULL },
     { "Xtal Frequency", menuXtalFreq },
     { "Keyer Mode",     menuKeyerMode },
     { "Backlight",      menuBacklight },
+    { "Message Repeat", menuMessageRepeat },
+    { "Serial Number",  menuSerial },
+    { "Edit Message",   menuEditMessage },
+    { "Serial Port",    menuSerialPort },
+    { "WSPR Beacon",    menuWsprBeacon },
+    { "WSPR Message",   menuWsprMessage },
 };
 
 enum eMenuTopLevel
@@ -124,6 +152,11 @@ static bool bInQuickVFOMenu;
 #define QUICK_MENU_TEXT         "A/B A=B R X SPLT"
 #define QUICK_MENU_SPLIT_TEXT   "A/B A=B r x splt"
 
+// Moving right from SPLT goes on to a second line for sending
+// the message memories
+#define QUICK_MENU_MESSAGE_TEXT "Msg 1  2  3  4"
+#define QUICK_MENU_FIRST_MESSAGE 5
+
 // RIT item as we will start here as this is most likely to use in a rush
 #define QUICK_MENU_RIT 2
 
@@ -139,8 +172,12 @@ static void quickMenuEqual();
 static void quickMenuRIT();
 static void quickMenuXIT();
 static void quickMenuSplit();
+static void quickMenuMessage1();
+static void quickMenuMessage2();
+static void quickMenuMessage3();
+static void quickMenuMessage4();
 
-#define NUM_QUICK_MENUS 5
+#define NUM_QUICK_MENUS 9
 static const struct sQuickMenuItem quickMenu[NUM_QUICK_MENUS] =
 {
     { 0,  quickMenuSwap },
@@ -148,6 +185,10 @@ static const struct sQuickMenuItem quickMenu[NUM_QUICK_MENUS] =
     { 8,  quickMenuRIT },
     { 10, quickMenuXIT },
     { 12, quickMenuSplit },
+    { 4,  quickMenuMessage1 },
+    { 7,  quickMenuMessage2 },
+    { 10, quickMenuMessage3 },
+    { 13, quickMenuMessage4 },
 };
 
 // Current quick menu item
@@ -171,50 +212,8 @@ static uint32_t lastBacklightTime;
 
 #endif
 
-// Band frequencies
-#ifdef SOTA2
-#define NUM_BANDS 2
-#else
-#define NUM_BANDS 13
-#endif
-
-static const struct  
-{
-    char     *bandName;     // Text for the menu
-    uint32_t  minFreq;      // Min band frequency
-    uint32_t  maxFreq;      // Max band frequency
-    uint32_t  defaultFreq;  // Where to start on this band e.g. QRP calling
-#ifdef SOTA2
-    uint32_t  leftFreq;     // Below this frequency light the left LED
-    uint32_t  rightFreq;    // Above this frequency light the right LED
-#endif
-    bool      bTXEnabled;   // True if TX enabled on this band
-    uint8_t   relayState;   // What state to put the relays in on this band
-#ifndef SOTA2
-    bool      bQuickVFOMenu;// True if this band appears in the quick VFO menu
-#endif
-}
-band[NUM_BANDS] =
-{
-#ifdef SOTA2
-    { "40m",      7000000,  7199999,  7030000,   7020000,  7040000, TX_ENABLED_40M,  RELAY_STATE_40M },
-    { "20m",     14000000, 14349999, 14060000,  14050000, 14070000, TX_ENABLED_20M,  RELAY_STATE_20M },
-#else
-    { "160m",     1810000,  1999999,  1836000, TX_ENABLED_160M, RELAY_STATE_160M, QUICK_VFO_160M },
-    { "80m",      3500000,  3799999,  3560000, TX_ENABLED_80M,  RELAY_STATE_80M,  QUICK_VFO_80M },
-    { "RWM 4996", 4996000,  4996000,  4996000, false,           RELAY_STATE_60M,  false },
-    { "60m UK",   5258500,  5263999,  5262000, TX_ENABLED_60M,  RELAY_STATE_60M,  QUICK_VFO_60M },
-    { "60m EU",   5354000,  5357999,  5355000, TX_ENABLED_60M,  RELAY_STATE_60M,  QUICK_VFO_60M },
-    { "40m",      7000000,  7199999,  7030000, TX_ENABLED_40M,  RELAY_STATE_40M,  QUICK_VFO_40M },
-    { "RWM 9996", 9996000,  9996000,  9996000, false,           RELAY_STATE_30M,  false },
-    { "30m",     10100000, 10150000, 10116000, TX_ENABLED_30M,  RELAY_STATE_30M,  QUICK_VFO_30M },
-    { "20m",     14000000, 14349999, 14060000, TX_ENABLED_20M,  RELAY_STATE_20M,  QUICK_VFO_20M },
-    { "17m",     18068000, 18167999, 18086000, TX_ENABLED_17M,  RELAY_STATE_17M,  QUICK_VFO_17M },
-    { "15m",     21000000, 21449999, 21060000, TX_ENABLED_15M,  RELAY_STATE_15M,  QUICK_VFO_15M },
-    { "12m",     24890000, 24989999, 24906000, TX_ENABLED_12M,  RELAY_STATE_12M,  QUICK_VFO_12M },
-    { "10m",     28000000, 29699999, 28060000, TX_ENABLED_10M,  RELAY_STATE_10M,  QUICK_VFO_10M },
-#endif
-};
+// Band frequencies and dividers - generated from bandplan.txt
+#include "bandplan.h"
 
 // The 12m band has reversed CW mode
 #define BAND_12M 11
@@ -238,9 +237,6 @@ static bool bAskToSaveXtalFreq = false;
 
 #endif
 	
-// Set to true if break in is enabled
-static bool bBreakIn = true;
-
 // Set to true if the oscillator is successfully initialised over I2C
 static bool bOscInit;
 
@@ -310,32 +306,69 @@ static struct sVFOState
 // True if in split mode (RX on current VFO, TX on other VFO)
 static bool bVFOSplit;
 
-// Set to true when testing RX mute function
-static bool bTestRXMute;
-
-// Set to true when RX clock enabled
-static bool bRXClockEnabled = true;
+// Bit for each clock in the clock output enables
+#define CLOCK_OUTPUT(clock) (1 << (clock))
+#define RX_CLOCK_OUTPUTS    (CLOCK_OUTPUT(RX_CLOCK_A) | CLOCK_OUTPUT(RX_CLOCK_B))
+#define TX_CLOCK_OUTPUT     CLOCK_OUTPUT(TX_CLOCK)
 
-// Set to true when TX clock enabled
-static bool bTXClockEnabled = true;
+// Shadow copy of the clock output enables so that only changes are written
+static uint8_t clockOutputs;
 
-// Set to true when morse output enabled
-static bool bTXOutEnabled = true;
+// The outputs are not known at power up so the first write sets all of them
+static bool bClockOutputsKnown;
 
-// Set to true when sidetone enabled
-static bool bSidetone = true;
+// Number of clock output enable writes made while keying
+static uint16_t keyClockWrites;
 
-// Delay before muting and unmuting
-static uint8_t muteDelay = 5;
-static uint8_t unmuteDelay = 5;
-static uint8_t txDelay = 10;
+// Number of clocks programmed by the last change of frequency
+static uint8_t tuneClockWrites;
 
-// Set to true when transmitting
-static bool bTransmitting = false;
+// The crystal frequency given to the oscillator driver
+static uint32_t xtalFreq;
 
-#ifndef SOTA2
-static void update_display();
-#endif
+// What each clock was last programmed with so that repeating the same
+// settings can be skipped
+static struct
+{
+    uint32_t freq;
+    uint32_t xtalFreq;
+    uint32_t segment;
+    int8_t   q;
+} clockSettings[NUM_CLOCKS];
+
+// Number of clock retunes skipped because nothing changed and performed
+static uint16_t retunesSkipped;
+static uint16_t retunesPerformed;
+
+// Clocks programmed in a way that resets the PLL and writes of only a
+// PLL numerator. The oscillator driver is taken to reset the PLL
+// whenever it programs a clock.
+static uint16_t retunesFull;
+static uint16_t retunesFractional;
+
+// The RX quadrature pair are retuned by writing their PLL directly
+static struct sSynthGroup rxGroup = { RX_CLOCK_OUTPUTS };
+
+// True if the RX PLL has been written directly since the oscillator
+// driver last programmed the RX clocks
+static bool bRXPLLDirect;
+
+// The TX clock is taken over from the oscillator driver and retuned by
+// writing its PLL directly while it is on the current band
+static struct sSynthGroup txGroup = { TX_CLOCK_OUTPUT };
+static bool bTXDirect;
+
+// Set when the display needs redrawing and the last time it was drawn (ms)
+static bool bDisplayDirty;
+static uint32_t lastDisplayTime;
+
+// Ask for the display to be redrawn
+// It is drawn from the main loop so that a fast moving dial only
+// redraws it every DISPLAY_INTERVAL
+static void update_display()
+{
+    bDisplayDirty = true;
+}
 
 // Works out the current RX frequency from the VFO settings
 static uint32_t getRXFreq()
@@ -442,138 +475,307 @@ static void setRelay()
 #endif
 }
 
-// Enable/disable the RX clock outputs
-static void enableRXClock( bool bEnable )
+// Set the clock output enables unless they are already set
+// Bit n of outputs is set to enable clock n
+// The TX clock's multisynth is powered down while its output is off.
+// It is powered up along with the output, which is before the
+// sequencer's TX delay so it has settled before the PA is keyed. The
+// RX pair are never powered down so that they keep their phase offset.
+static void setClockOutputs( uint8_t outputs )
+{
+    if( !bClockOutputsKnown || (outputs != clockOutputs) )
+    {
+        bool bOK;
+
+        // The drive strength for the band is written with the outputs
+        synthSetDrive( RX_CLOCK_A, band[currentBand].rxDrive );
+        synthSetDrive( RX_CLOCK_B, band[currentBand].rxDrive );
+        synthSetDrive( TX_CLOCK, band[currentBand].txDrive );
+
+        BUS_TRACE_START( start );
+        bOK = synthSetOutputs( outputs, outputs | RX_CLOCK_OUTPUTS );
+        BUS_TRACE_END( busOpClocks, start, synthBusStatus() );
+        bClockOutputsKnown = bOK;
+
+        // Count the writes made while keying
+        if( txSeqKeying() )
+        {
+            keyClockWrites++;
+        }
+    }
+
+    clockOutputs = outputs;
+}
+
+// Find the divider segment for a clock frequency
+// This is the current band's total output divider if the frequency is
+// close enough to the band for it to keep the VCO in range, else 0
+static uint32_t clockSegment( uint32_t freq )
 {
-    oscClockEnable( RX_CLOCK_A, bEnable );
-    oscClockEnable( RX_CLOCK_B, bEnable );
+    uint32_t segment = 0;
+
+    if( ((freq + BAND_DIVIDER_MARGIN) >= band[currentBand].minFreq) &&
+        (freq <= (band[currentBand].maxFreq + BAND_DIVIDER_MARGIN)) )
+    {
+        segment = band[currentBand].outDiv * band[currentBand].rDiv;
+    }
+
+    return segment;
 }
 
-// Enable/disable the TX clock output
-static void enableTXClock( bool bEnable )
+// Program a clock's frequency and count it for the current tune
+// Nothing is written if the clock is already set up this way
+static void setClockFrequency( uint8_t clock, uint32_t freq, int8_t q )
+{
+    if( (clockSettings[clock].freq == freq) &&
+        (clockSettings[clock].q == q) &&
+        (clockSettings[clock].xtalFreq == xtalFreq) )
+    {
+        retunesSkipped++;
+    }
+    else
+    {
+        BUS_TRACE_START( start );
+        oscSetFrequency( clock, freq, q );
+        BUS_TRACE_END( busOpTune, start, ioI2CLibraryStatus() );
+        synthInvalidate();
+
+        // The driver may have put this clock on the PLL the TX clock
+        // was taken over on so the TX clock must be checked again
+        if( bTXDirect && (clock != TX_CLOCK) )
+        {
+            clockSettings[TX_CLOCK].freq = 0;
+        }
+        clockSettings[clock].segment = clockSegment( freq );
+        clockSettings[clock].freq = freq;
+        clockSettings[clock].q = q;
+        clockSettings[clock].xtalFreq = xtalFreq;
+        tuneClockWrites++;
+        retunesPerformed++;
+        retunesFull++;
+    }
+}
+
+// Set the crystal frequency in the oscillator driver
+// The clocks pick it up when they are next set
+static void setXtalFrequency( uint32_t freq )
 {
-    oscClockEnable( TX_CLOCK, bEnable );
+    oscSetXtalFrequency( freq );
+    synthSetXtalFrequency( freq );
+    xtalFreq = freq;
 }
 
-// Turns on/off the TX clock and PA
-// If break-in off disables this
-static void Transmit( bool bTX )
+// Program the quadrature pair of RX clocks together
+// The oscillator driver sets the pair up, including the phase offset
+// between them, whenever the band segment, crystal frequency or
+// quadrature direction changes. Within a segment the pair stays on the
+// same integer divider from the PLL they share so only that PLL needs
+// changing, which is written directly without a reset so the phase
+// offset is kept. How the driver set them up is read back from the
+// oscillator rather than assumed and if it cannot be retuned this way
+// the driver is used every time.
+static void setRXClocks( uint32_t freq, int8_t q )
 {
-    if( bBreakIn )
+    uint32_t segment = clockSegment( freq );
+
+    if( (clockSettings[RX_CLOCK_A].freq == freq) &&
+        (clockSettings[RX_CLOCK_B].freq == freq) &&
+        (clockSettings[RX_CLOCK_B].q == q) &&
+        (clockSettings[RX_CLOCK_A].xtalFreq == xtalFreq) &&
+        (clockSettings[RX_CLOCK_B].xtalFreq == xtalFreq) )
     {
-        if( bTX )
+        retunesSkipped += 2;
+    }
+    else
+    {
+        bool bDirect = (segment != 0) &&
+                       (clockSettings[RX_CLOCK_A].segment == segment) &&
+                       (clockSettings[RX_CLOCK_B].segment == segment) &&
+                       (clockSettings[RX_CLOCK_B].q == q) &&
+                       (clockSettings[RX_CLOCK_A].xtalFreq == xtalFreq) &&
+                       (clockSettings[RX_CLOCK_B].xtalFreq == xtalFreq);
+
+        if( bDirect )
         {
-            // Turn on the TX clock
-            if( bTXClockEnabled )
-            {
-                enableTXClock( true );
-                delay(txDelay);
-            }
+            BUS_TRACE_START( start );
+            bDirect = synthRetune( &rxGroup, freq );
+            BUS_TRACE_END( busOpTune, start, synthBusStatus() );
+        }
 
-            // Set the morse output high
-            if( bTXOutEnabled )
+        if( bDirect )
+        {
+            for( uint8_t clock = RX_CLOCK_A ; clock <= RX_CLOCK_B ; clock++ )
             {
-                ioWriteMorseOutputHigh();
+                clockSettings[clock].freq = freq;
             }
+            bRXPLLDirect = true;
+            tuneClockWrites += 2;
+            retunesPerformed += 2;
+
+            // Both clocks are retuned by one PLL write
+            retunesFractional++;
         }
         else
         {
-            // Delay the same as before transmit so that the dot
-            // or dash is not truncated
-            delay(txDelay);
-
-            // Set the morse output low
-            ioWriteMorseOutputLow();
-            delay(txDelay);
+            setClockFrequency( RX_CLOCK_A, freq, 0 );
+            setClockFrequency( RX_CLOCK_B, freq, q );
 
-            // Turn off the TX clock
-            enableTXClock( false );
+            // The driver does not know the PLL has been changed so may
+            // have left it alone if it thinks it is already right
+            if( bRXPLLDirect )
+            {
+                BUS_TRACE_START( start );
+                synthRetune( &rxGroup, freq );
+                BUS_TRACE_END( busOpTune, start, synthBusStatus() );
+                bRXPLLDirect = false;
+            }
         }
-        bTransmitting = bTX;
     }
 }
 
-static void muteRX( bool bMute )
+// Program the TX clock
+// On the current band the clock is put on the band's integer divider
+// from a PLL of its own once, with a PLL reset, and is then retuned by
+// writing only the PLL numerator. Off the band, or if there is no PLL
+// free for it, the oscillator driver is used.
+static void setTXClock( uint32_t freq )
 {
-    if( bMute )
+    uint32_t segment = clockSegment( freq );
+    uint16_t div = band[currentBand].outDiv;
+
+    if( (clockSettings[TX_CLOCK].freq == freq) &&
+        (clockSettings[TX_CLOCK].q == 0) &&
+        (clockSettings[TX_CLOCK].xtalFreq == xtalFreq) )
     {
-        ioWriteRXEnableLow();
+        retunesSkipped++;
     }
     else
     {
-        ioWriteRXEnableHigh();
-    }
-}
+        bool bOK = false;
 
-static void sidetoneOn( bool bOn )
-{
-    if( bSidetone )
-    {
-        if( bOn )
+        if( (segment != 0) && (band[currentBand].rDiv == 1) )
+        {
+            BUS_TRACE_START( start );
+            if( bTXDirect && (txGroup.div == div) )
+            {
+                bOK = synthRetune( &txGroup, freq );
+                if( bOK )
+                {
+                    retunesFractional++;
+                }
+            }
+            if( !bOK )
+            {
+                bOK = synthTakeOver( &txGroup, div, freq );
+                if( bOK )
+                {
+                    retunesFull++;
+                }
+            }
+            BUS_TRACE_END( busOpTune, start, synthBusStatus() );
+        }
+
+        if( bOK )
         {
-            ioWriteSidetoneOn();
+            clockSettings[TX_CLOCK].segment = segment;
+            clockSettings[TX_CLOCK].freq = freq;
+            clockSettings[TX_CLOCK].q = 0;
+            clockSettings[TX_CLOCK].xtalFreq = xtalFreq;
+            tuneClockWrites++;
+            retunesPerformed++;
         }
         else
         {
-            ioWriteSidetoneOff();
+            setClockFrequency( TX_CLOCK, freq, 0 );
         }
+        bTXDirect = bOK;
     }
 }
 
-// Handle key up and down - mute RX, transmit, sidetone etc.
-void keyDown( bool bDown )
+// Enable/disable the RX clock outputs
+static void enableRXClock( bool bEnable )
 {
-    if( bDown )
+    if( bEnable )
     {
-        // Key down only if TX is enabled on the current
-        // TX frequency
-        if( txEnabled() )
-        {
-            if( !bTestRXMute )
-            {
-                // Mute RX first
-                muteRX( true );
-                delay(muteDelay);
-            }
+        setClockOutputs( clockOutputs | RX_CLOCK_OUTPUTS );
+    }
+    else
+    {
+        setClockOutputs( clockOutputs & ~RX_CLOCK_OUTPUTS );
+    }
+}
 
-            if( bRXClockEnabled )
-            {
-                // Turn off the RX clock
-                enableRXClock( false );
-            }
+// Enable/disable the TX clock output
+static void enableTXClock( bool bEnable )
+{
+    if( bEnable )
+    {
+        setClockOutputs( clockOutputs | TX_CLOCK_OUTPUT );
+    }
+    else
+    {
+        setClockOutputs( clockOutputs & ~TX_CLOCK_OUTPUT );
+    }
+}
 
-            // Turn on the TX oscillator and PA
-            Transmit( true );
+// The clock outputs for transmitting - the RX clock off and the TX clock on
+static uint8_t txClockOutputs()
+{
+    uint8_t outputs = clockOutputs;
 
-            // Turn on sidetone
-            sidetoneOn( true );
-        }
+    if( txSeqSettings.bRXClockEnabled )
+    {
+        // Turn off the RX clock
+        outputs &= ~RX_CLOCK_OUTPUTS;
     }
-    else
+
+    if( txSeqSettings.bBreakIn && txSeqSettings.bTXClockEnabled )
     {
-        // Delay the same as before key down so that dot or dash
-        // is not truncated
-        delay(muteDelay);
+        // Turn on the TX clock
+        outputs |= TX_CLOCK_OUTPUT;
+    }
 
-        // Turn off the PA and TX oscillator
-        Transmit( false );
+    return outputs;
+}
 
-        // Turn off sidetone
-        sidetoneOn( false );
+// Switch the clock outputs over for TX or RX - for the sequencer
+// Returns true if the TX clock is on
+bool setTXRXClocks( bool bTX )
+{
+    uint8_t outputs;
 
-        if( bRXClockEnabled )
+    if( bTX )
+    {
+        outputs = txClockOutputs();
+    }
+    else
+    {
+        outputs = clockOutputs & ~TX_CLOCK_OUTPUT;
+        if( txSeqSettings.bRXClockEnabled )
         {
             // Turn on the RX clock
-            enableRXClock( true );
-        }
-
-        if( !bTestRXMute )
-        {
-            // Unmute the RX last
-            delay(unmuteDelay);
-            muteRX( false );
+            outputs |= RX_CLOCK_OUTPUTS;
         }
     }
+    setClockOutputs( outputs );
+
+    return (outputs & TX_CLOCK_OUTPUT) != 0;
+}
+
+// Key down only if TX is enabled on the current TX frequency
+void keyDown( bool bDown )
+{
+    txSeqKeyDown( bDown && txEnabled() );
+
+    // May be able to switch the clocks straight away
+    txSequencer();
+}
+
+// Key down or up from the keyer timer interrupt
+// Cannot use I2C here so the main loop switches the clocks
+void keyDownInterrupt( bool bDown )
+{
+    txSeqKeyDown( bDown && txEnabled() );
 }
 
 // Display the morse character if not in the menu
@@ -582,7 +784,7 @@ void displayMorse( char *text )
 /*
     if( currentMode != modeMenu )
     {
-        displayText( MORSE_LINE, text, false );
+        writeLine( MORSE_LINE, text, false );
     }
 */
 }
@@ -596,7 +798,7 @@ void displayMorse( char *text )
 // Left LED lit below the centre
 // Right LED lit above the centre
 // All LEDs light out of band
-static void update_display()
+static void draw_display()
 {
     uint32_t freq = getRXFreq();
 
@@ -625,6 +827,21 @@ static void update_display()
 
 #else
 
+// Where the cursor was last put and how it is shown so that it can be
+// put back after the display has been drawn
+static uint8_t cursorCol;
+static uint8_t cursorLine;
+static uint8_t cursorType;
+
+// Set the cursor position and how it is shown
+static void setCursor( uint8_t col, uint8_t line, uint8_t type )
+{
+    cursorCol = col;
+    cursorLine = line;
+    cursorType = type;
+    displayCursor( col, line, type );
+}
+
 // Set the correct cursor for the VFO mode
 static void update_cursor()
 {
@@ -644,7 +861,7 @@ static void update_cursor()
             }
         }
 
-        displayCursor( vfoCursorTransition[cursorIndex].x, line, cursorUnderline );
+        setCursor( vfoCursorTransition[cursorIndex].x, line, cursorUnderline );
     }
 }
 
@@ -663,11 +880,84 @@ static bool getCWReverse()
 }
 
 
+// What was last written to each line so that writing the same text
+// again can be skipped. The text is only kept if it fits on the line.
+static struct
+{
+    char    text[LCD_WIDTH + 1];
+    uint8_t split;          // Split column when it was written
+    bool    bClear;
+    bool    bValid;
+} lineShadow[LCD_HEIGHT];
+
+// Current split column of each line
+static uint8_t lineSplit[LCD_HEIGHT];
+
+// Characters written to the display and skipped because they were
+// already showing, and the characters written by the last update
+static uint16_t displayCharsWritten;
+static uint16_t displayCharsSkipped;
+static uint8_t updateChars;
+
+// Write text to a display line unless it is already showing
+static void writeLine( uint8_t line, char *text, bool bClear )
+{
+    uint8_t len = strlen( text );
+    uint8_t chars = bClear ? LCD_WIDTH : len;
+
+    if( (line < LCD_HEIGHT) &&
+        lineShadow[line].bValid &&
+        (lineShadow[line].bClear == bClear) &&
+        (lineShadow[line].split == lineSplit[line]) &&
+        (strcmp( lineShadow[line].text, text ) == 0) )
+    {
+        displayCharsSkipped += chars;
+    }
+    else
+    {
+        displayText( line, text, bClear );
+        displayCharsWritten += chars;
+        updateChars += chars;
+
+        if( line < LCD_HEIGHT )
+        {
+            lineShadow[line].bValid = (len <= LCD_WIDTH);
+            if( lineShadow[line].bValid )
+            {
+                strcpy( lineShadow[line].text, text );
+                lineShadow[line].split = lineSplit[line];
+                lineShadow[line].bClear = bClear;
+            }
+        }
+    }
+}
+
+// Split a display line at a column
+// Only changes where later text goes so the line does not need rewriting
+static void splitLine( uint8_t col, uint8_t line )
+{
+    displaySplitLine( col, line );
+
+    if( line < LCD_HEIGHT )
+    {
+        lineSplit[line] = col;
+    }
+}
+
+// Turn the LCD backlight on or off
+static void setBacklight( bool bOn )
+{
+    BUS_TRACE_START( start );
+    lcdBacklight( bOn );
+    BUS_TRACE_END( busOpBacklight, start, ioI2CLibraryStatus() );
+}
+
 // Update the display with the frequency and morse wpm
-static void update_display()
+static void draw_display()
 {
-    char wpmText[TEXT_BUF_LEN];
-    char freqText[TEXT_BUF_LEN*2];
+    BUS_TRACE_START( start );
+    char freqText[TEXT_BUF_LEN];
+    char *p;
     
     // Frequency for the first and second lines
     uint32_t freq1 = 0;
@@ -687,24 +977,8 @@ static void update_display()
     // Get the current wpm.
     uint8_t wpm = morseGetWpm();
 
-    // Create the text for the morse speed
-    if( wpm > 0 )
-    {
-        sprintf( wpmText, "%2dwpm", wpm);
-    }
-    else
-    {
-        // A morse wpm of 0 means straight key mode
-        // May be in tune mode (continuous transmit until dot pressed)
-        if( morseInTuneMode() )
-        {
-            sprintf( wpmText, "Tune " );
-        }
-        else
-        {
-            sprintf( wpmText, "SKey " );
-        }
-    }
+    // Count the characters this update writes
+    updateChars = 0;
 
     // First line begins with a letter to tell us which VFO (A or B) or
     // if the oscillator is not OK (N)
@@ -761,28 +1035,54 @@ static void update_display()
     freq1 = getRXFreq();
 
     // Line 1 has the frequency as determined above plus the morse WPM
-    sprintf( freqText, "%c%c%5lu%c%02lu %s", cLine1A, cLine1B, freq1/1000, cDot, (freq1%1000)/10, wpmText);
-    displayText( FREQ_LINE, freqText, true );
+    p = formatChar( freqText, cLine1A );
+    p = formatChar( p, cLine1B );
+    p = formatFrequency( p, freq1, cDot );
+    p = formatChar( p, ' ' );
+
+    // Followed by the morse speed
+    if( wpm > 0 )
+    {
+        formatText( formatUnsigned( p, wpm, 2, ' ' ), "wpm" );
+    }
+    else
+    {
+        // A morse wpm of 0 means straight key mode
+        // May be in tune mode (continuous transmit until dot pressed)
+        if( morseInTuneMode() )
+        {
+            formatText( p, "Tune " );
+        }
+        else
+        {
+            formatText( p, "SKey " );
+        }
+    }
+    writeLine( FREQ_LINE, freqText, true );
     
     // All modes other than simplex have a second line
     if( bVFOSplit || (vfoState[currentVFO].mode != vfoSimplex) )
     {
-        displaySplitLine( 0, FREQ_LINE + 1 );
-        sprintf( freqText, "%c%c%5lu%c%02lu", cLine2A, cLine2B, freq2/1000, cDot, (freq2%1000)/10);
-        displayText( FREQ_LINE + 1, freqText, true );
+        splitLine( 0, FREQ_LINE + 1 );
+        p = formatChar( freqText, cLine2A );
+        p = formatChar( p, cLine2B );
+        formatFrequency( p, freq2, cDot );
+        writeLine( FREQ_LINE + 1, freqText, true );
 
         // Second line is split so frequency not overwritten if we are displaying morse
-        displaySplitLine( 10, FREQ_LINE + 1 );
+        splitLine( 10, FREQ_LINE + 1 );
     }
     else
     {
         // Second line is not split and needs to be cleared if not in the menu or quick menu
         if( (currentMode != modeQuickMenu) && (currentMode != modeMenu) )
         {
-            displaySplitLine( 0, FREQ_LINE + 1 );
-            displayText( FREQ_LINE + 1, "", true );
+            splitLine( 0, FREQ_LINE + 1 );
+            writeLine( FREQ_LINE + 1, "", true );
         }
     }
+
+    BUS_TRACE_END( busOpDisplay, start, ioI2CLibraryStatus() );
 }
 #endif
 
@@ -807,8 +1107,7 @@ static void setRXFrequency( uint32_t freq )
 
     // Set the oscillator frequency. This will set the correct quadrature
     // phase shift.
-    oscSetFrequency( RX_CLOCK_A, oscFreq, 0 );
-    oscSetFrequency( RX_CLOCK_B, oscFreq, bCWReverse ? 1 : -1 );
+    setRXClocks( oscFreq, bCWReverse ? 1 : -1 );
 
     // Set the relay
     setRelay();
@@ -821,8 +1120,15 @@ static void setFrequencies()
     setBandFromFrequency( getRXFreq() );
 
     // Set RX and TX frequencies
+    tuneClockWrites = 0;
     setRXFrequency( getRXFreq() );
-    oscSetFrequency( TX_CLOCK, getTXFreq(), 0 );
+    setTXClock( getTXFreq() );
+
+    // The band's drive strength and the power down may need setting
+    // again after a change of band or if the oscillator driver has
+    // written the clock control registers. Only changes are written.
+    bClockOutputsKnown = false;
+    setClockOutputs( clockOutputs );
 
     // Ensure the display and cursor reflect this
     update_display();
@@ -855,33 +1161,40 @@ static void setBand( int newBand )
 static void menuDisplayText()
 {
     char text[TEXT_BUF_LEN];
+    char *p;
 
     // Turn off the split line for the menu
-    displaySplitLine( 0, MENU_LINE );
+    splitLine( 0, MENU_LINE );
     
     // Display either the menu or the sub-menu text
     if( currentSubMenu == 0 )
     {
         // Not in a sub-menu
-        sprintf( text, "%c %s", 'A' + currentMenu, menu[currentMenu].text );
+        p = formatChar( text, 'A' + currentMenu );
+        p = formatChar( p, ' ' );
+        formatText( p, menu[currentMenu].text );
     }
     else
     {
         // In a sub-menu
-        sprintf( text, "%c.%d %s", 'A' + currentMenu, currentSubMenu, menu[currentMenu].subMenu[currentSubMenu].text );
+        p = formatChar( text, 'A' + currentMenu );
+        p = formatChar( p, '.' );
+        p = formatUnsigned( p, currentSubMenu, 0, ' ' );
+        p = formatChar( p, ' ' );
+        formatText( p, menu[currentMenu].subMenu[currentSubMenu].text );
     }
     
-    displayText( MENU_LINE, text, true );
+    writeLine( MENU_LINE, text, true );
     
     // Turn off the cursor
-    displayCursor( 0, 0, cursorOff );
+    setCursor( 0, 0, cursorOff );
 }
 
 // Enter the wpm setting mode
 static void enterWpm()
 {
     // Make the cursor blink on the wpm
-    displayCursor( WPM_COL, WPM_LINE, cursorBlink );
+    setCursor( WPM_COL, WPM_LINE, cursorBlink );
 
     currentMode = modeWpm;
 }
@@ -913,7 +1226,7 @@ static void enterVFOBandMenu()
     menuVFOBand(false, false, false, false, false, false, false, false);
 
     // Turn off the cursor
-    displayCursor( 0, 0, cursorOff );
+    setCursor( 0, 0, cursorOff );
 }
 
 // Go back to VFO mode
@@ -929,8 +1242,8 @@ static void enterVFOMode()
     update_cursor();
 
     // Clear the second line as no longer in the menu
-    displaySplitLine( 0, FREQ_LINE + 1 );
-    displayText( FREQ_LINE+1, "", true);
+    splitLine( 0, FREQ_LINE + 1 );
+    writeLine( FREQ_LINE+1, "", true);
 
     // Update the display with the correct split for the current VFO mode
     update_display();
@@ -944,7 +1257,6 @@ void vfoSwap()
 
     // Update the frequencies and display
     setFrequencies();
-    update_display();
 }
 
 static void quickMenuSwap()
@@ -1106,18 +1418,59 @@ static void quickMenuSplit()
     enterVFOMode();
 }
 
+// Send a message memory or stop the one being sent
+static void quickMenuMessage( uint8_t message )
+{
+    if( messageSending() )
+    {
+        messageStop();
+    }
+    else
+    {
+        messageSend( message );
+    }
+    enterVFOMode();
+}
+
+static void quickMenuMessage1()
+{
+    quickMenuMessage( 0 );
+}
+
+static void quickMenuMessage2()
+{
+    quickMenuMessage( 1 );
+}
+
+static void quickMenuMessage3()
+{
+    quickMenuMessage( 2 );
+}
+
+static void quickMenuMessage4()
+{
+    quickMenuMessage( 3 );
+}
+
 // Display the quick menu text
 static void quickMenuDisplayText()
 {
     // Turn off the split line for the menu
-    displaySplitLine( 0, MENU_LINE );
+    splitLine( 0, MENU_LINE );
 
     // Display the quick menu
     // Slightly different text in split mode
-    displayText( MENU_LINE, (bVFOSplit ? QUICK_MENU_SPLIT_TEXT : QUICK_MENU_TEXT), true );
+    if( quickMenuItem >= QUICK_MENU_FIRST_MESSAGE )
+    {
+        writeLine( MENU_LINE, QUICK_MENU_MESSAGE_TEXT, true );
+    }
+    else
+    {
+        writeLine( MENU_LINE, (bVFOSplit ? QUICK_MENU_SPLIT_TEXT : QUICK_MENU_TEXT), true );
+    }
     
     // Make the cursor blink on the current item
-    displayCursor( quickMenu[quickMenuItem].pos, MENU_LINE, cursorBlink );
+    setCursor( quickMenu[quickMenuItem].pos, MENU_LINE, cursorBlink );
 }
 
 // Enter the quick menu
@@ -1388,8 +1741,8 @@ static bool menuVFOBand( bool bCW, bool bCCW, bool bShortPress, bool bLongPress,
 
     // Display the current band
     char buf[TEXT_BUF_LEN];
-    sprintf( buf, "Band: %s", band[newBand].bandName);
-    displayText( MENU_LINE, buf, true );
+    formatText( formatText( buf, "Band: " ), band[newBand].bandName );
+    writeLine( MENU_LINE, buf, true );
 
     // Short press sets the new band
     if( bShortPress )
@@ -1458,11 +1811,11 @@ static bool menuVFOMode( bool bCW, bool bCCW, bool bShortPress, bool bLongPress,
 
     if( bCWReverse )
     {
-        displayText( MENU_LINE, "VFO CW Reverse", true );
+        writeLine( MENU_LINE, "VFO CW Reverse", true );
     }
     else
     {
-        displayText( MENU_LINE, "VFO CW Normal", true );
+        writeLine( MENU_LINE, "VFO CW Normal", true );
     }
     
     return bUsed;
@@ -1473,21 +1826,65 @@ static bool menuBreakIn( bool bCW, bool bCCW, bool bShortPress, bool bLongPress,
     // Set to true if we have used the presses etc
     bool bUsed = false;
     
-    // Left or right toggles
+    // Left or right steps through on, semi and off
     if( bShortPressLeft || bShortPressRight )
     {
-        bBreakIn = !bBreakIn;
+        if( !txSeqSettings.bBreakIn )
+        {
+            txSeqSettings.bBreakIn = true;
+            txSeqSettings.bSemiBreakIn = false;
+        }
+        else if( !txSeqSettings.bSemiBreakIn )
+        {
+            txSeqSettings.bSemiBreakIn = true;
+        }
+        else
+        {
+            txSeqSettings.bBreakIn = false;
+        }
         bUsed = true;
     }
 
-    if( bBreakIn )
+    if( !txSeqSettings.bBreakIn )
+    {
+        writeLine( MENU_LINE, "Break in: Off", true );
+    }
+    else if( txSeqSettings.bSemiBreakIn )
     {
-        displayText( MENU_LINE, "Break in: On", true );
+        writeLine( MENU_LINE, "Break in: Semi", true );
     }
     else
     {
-        displayText( MENU_LINE, "Break in: Off", true );
+        writeLine( MENU_LINE, "Break in: On", true );
+    }
+    
+    return bUsed;
+}
+
+static bool menuHangTime( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = false;
+
+    if( bCW && (txSeqSettings.hangTime < MAX_HANG_TIME) )
+    {
+        txSeqSettings.hangTime += HANG_TIME_STEP;
+        bUsed = true;
+    }
+    else if( bCCW && (txSeqSettings.hangTime > MIN_HANG_TIME) )
+    {
+        txSeqSettings.hangTime -= HANG_TIME_STEP;
+        bUsed = true;
+    }
+    else if( bShortPress )
+    {
+        txSeqSettings.hangTime = DEFAULT_HANG_TIME;
+        bUsed = true;
     }
+
+    char buf[TEXT_BUF_LEN];
+    formatLabel( buf, "Hang: ", txSeqSettings.hangTime, "ms" );
+    writeLine( MENU_LINE, buf, true );
     
     return bUsed;
 }
@@ -1500,17 +1897,17 @@ static bool menuSidetone( bool bCW, bool bCCW, bool bShortPress, bool bLongPress
     // Left or right toggles
     if( bShortPressLeft || bShortPressRight )
     {
-        bSidetone = !bSidetone;
+        txSeqSettings.bSidetone = !txSeqSettings.bSidetone;
         bUsed = true;
     }
 
-    if( bSidetone )
+    if( txSeqSettings.bSidetone )
     {
-        displayText( MENU_LINE, "Sidetone: Enabled", true );
+        writeLine( MENU_LINE, "Sidetone: Enabled", true );
     }
     else
     {
-        displayText( MENU_LINE, "Sidetone: Disabled", true );
+        writeLine( MENU_LINE, "Sidetone: Disabled", true );
     }
     
     return bUsed;
@@ -1524,19 +1921,19 @@ static bool menuTestRXMute( bool bCW, bool bCCW, bool bShortPress, bool bLongPre
     // Left or right toggles
     if( bShortPressLeft || bShortPressRight )
     {
-        bTestRXMute = !bTestRXMute;
+        txSeqSettings.bTestRXMute = !txSeqSettings.bTestRXMute;
         bUsed = true;
     }
 
-    if( bTestRXMute )
+    if( txSeqSettings.bTestRXMute )
     {
-        muteRX( true );
-        displayText( MENU_LINE, "Test RX Mute: On", true );
+        txSeqMuteRX( true );
+        writeLine( MENU_LINE, "Test RX Mute: On", true );
     }
     else
     {
-        muteRX( false );
-        displayText( MENU_LINE, "Test RX Mute: Off", true );
+        txSeqMuteRX( false );
+        writeLine( MENU_LINE, "Test RX Mute: Off", true );
     }
     
     return bUsed;
@@ -1551,62 +1948,79 @@ static bool menuRXClock( bool bCW, bool bCCW, bool bShortPress, bool bLongPress,
     // Left or right toggles
     if( bShortPressLeft || bShortPressRight )
     {
-        bRXClockEnabled = !bRXClockEnabled;
+        txSeqSettings.bRXClockEnabled = !txSeqSettings.bRXClockEnabled;
         bUsed = true;
     }
 
-    if( bRXClockEnabled )
+    if( txSeqSettings.bRXClockEnabled )
     {
         enableRXClock( true );
-        displayText( MENU_LINE, "RX Clock: Enabled", true );
+        writeLine( MENU_LINE, "RX Clock: Enabled", true );
     }
     else
     {
         enableRXClock( false );
-        displayText( MENU_LINE, "RX Clock: Disabled", true );
+        writeLine( MENU_LINE, "RX Clock: Disabled", true );
     }
     
     return bUsed;
 }
 
-static bool menuTXDelay( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+// Adjust one of the TX/RX switching delays (us) and store it in NVRAM
+// Fine steps for short delays and coarser steps above QSK_DELAY_FINE_MAX
+// A short press sets the default
+static bool adjustQSKDelay( uint16_t *pDelay, uint16_t defaultDelay, void (*nvramWrite)(uint16_t), bool bCW, bool bCCW, bool bShortPress )
 {
     // Set to true if we have used the presses etc
     bool bUsed = false;
-    
+
     if( bCW )
     {
-        if( txDelay < 50 )
+        if( *pDelay < QSK_DELAY_FINE_MAX )
         {
-            txDelay++;
+            *pDelay += QSK_DELAY_FINE_STEP;
         }
-        else if( txDelay < 500 )
+        else if( *pDelay < MAX_QSK_DELAY )
         {
-            txDelay += 50;
+            *pDelay += QSK_DELAY_COARSE_STEP;
         }
         bUsed = true;
     }
     else if( bCCW )
     {
-        if( txDelay > 50 )
+        if( *pDelay > QSK_DELAY_FINE_MAX )
         {
-            txDelay -= 50;
+            *pDelay -= QSK_DELAY_COARSE_STEP;
         }
-        else if( txDelay > 0 )
+        else if( *pDelay >= QSK_DELAY_FINE_STEP )
         {
-            txDelay--;
+            *pDelay -= QSK_DELAY_FINE_STEP;
         }
         bUsed = true;
     }
     else if( bShortPress )
     {
-        txDelay = 10;
+        *pDelay = defaultDelay;
         bUsed = true;
     }
-    char buf[TEXT_BUF_LEN];
-    sprintf( buf, "TX delay: %d", txDelay);
-    displayText( MENU_LINE, buf, true );
-    
+
+    if( bUsed )
+    {
+        nvramWrite( *pDelay );
+    }
+
+    return bUsed;
+}
+
+static bool menuTXDelay( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = adjustQSKDelay( &txSeqSettings.txDelay, DEFAULT_TX_DELAY, nvramWriteTXDelay, bCW, bCCW, bShortPress );
+
+    char buf[TEXT_BUF_LEN];
+    formatLabel( buf, "TX dly: ", txSeqSettings.txDelay, "us" );
+    writeLine( MENU_LINE, buf, true );
+    
     return bUsed;
 }
 
@@ -1618,17 +2032,17 @@ static bool menuTXClock( bool bCW, bool bCCW, bool bShortPress, bool bLongPress,
     // Left or right toggles
     if( bShortPressLeft || bShortPressRight )
     {
-        bTXClockEnabled = !bTXClockEnabled;
+        txSeqSettings.bTXClockEnabled = !txSeqSettings.bTXClockEnabled;
         bUsed = true;
     }
 
-    if( bTXClockEnabled )
+    if( txSeqSettings.bTXClockEnabled )
     {
-        displayText( MENU_LINE, "TX Clock: Enabled", true );
+        writeLine( MENU_LINE, "TX Clock: Enabled", true );
     }
     else
     {
-        displayText( MENU_LINE, "TX Clock: Disabled", true );
+        writeLine( MENU_LINE, "TX Clock: Disabled", true );
     }
     
     return bUsed;
@@ -1642,101 +2056,374 @@ static bool menuTXOut( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, b
     // Left or right toggles
     if( bShortPressLeft || bShortPressRight )
     {
-        bTXOutEnabled = !bTXOutEnabled;
+        txSeqSettings.bTXOutEnabled = !txSeqSettings.bTXOutEnabled;
         bUsed = true;
     }
 
-    if( bTXOutEnabled )
+    if( txSeqSettings.bTXOutEnabled )
     {
-        displayText( MENU_LINE, "TX Out: Enabled", true );
+        writeLine( MENU_LINE, "TX Out: Enabled", true );
     }
     else
     {
-        displayText( MENU_LINE, "TX Out: Disabled", true );
+        writeLine( MENU_LINE, "TX Out: Disabled", true );
     }
     
     return bUsed;
 }
 
-static bool menuUnmuteDelay( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+// Pages of the statistics menu
+enum eStatsPage
+{
+    statsLatency,   // One page for each keying latency stage
+    statsLatencyMin = statsLatency + NUM_LATENCY_STAGES,
+    statsLatencyHistogram = statsLatencyMin + NUM_LATENCY_STAGES,
+    statsKeyClock = statsLatencyHistogram + NUM_LATENCY_STAGES,
+    statsTuneClock,
+    statsRetunesSkipped,
+    statsRetunesPerformed,
+    statsRetunesFull,
+    statsRetunesFractional,
+    statsSynthBytes,
+    statsDisplayUpdate,
+    statsDisplayWritten,
+    statsDisplaySkipped,
+#ifdef ENABLE_BUS_TRACE
+    statsBusOp,     // One page for each type of bus operation
+    statsBusDevice = statsBusOp + NUM_BUS_OPS,      // Times for each device
+    statsBusErrors = statsBusDevice + NUM_BUS_DEVICES, // Errors for each device
+    statsBusTrace = statsBusErrors + NUM_BUS_DEVICES,  // The trace, newest first
+    NUM_STATS_PAGES = statsBusTrace + BUS_TRACE_LEN
+#else
+    NUM_STATS_PAGES
+#endif
+};
+
+// Short names for the latency stages
+static const char *latencyName[NUM_LATENCY_STAGES] =
 {
-    // Set to true if we have used the presses etc
-    bool bUsed = false;
-    
-    if( bCW )
+    "Pad ",
+    "Clk ",
+    "Swap ",
+    "PA ",
+    "Sym ",
+};
+
+// The statistics page being shown
+static uint8_t statsPage;
+
+// Write a name and the mean and max of some times (us)
+// Times of 10ms and over are shown in ms so that they fit
+static char *formatTimes( char *buf, const char *name, uint32_t mean, uint32_t max )
+{
+    char *units = "us";
+
+    if( max >= 10000 )
     {
-        if( unmuteDelay < 50 )
-        {
-            unmuteDelay++;
-        }
-        else if( unmuteDelay < 500 )
-        {
-            unmuteDelay += 50;
-        }
-        bUsed = true;
+        mean /= 1000;
+        max /= 1000;
+        units = "ms";
     }
-    else if( bCCW )
+
+    buf = formatText( buf, name );
+    buf = formatUnsigned( buf, mean, 0, ' ' );
+    buf = formatChar( buf, '/' );
+    return formatLabel( buf, "", max, units );
+}
+
+// Show the mean and max for a latency stage
+static void formatLatency( char *buf, enum eLatencyStage stage )
+{
+    struct sLatencyStats stats;
+
+    latencyRead( stage, &stats );
+    formatTimes( buf, latencyName[stage], stats.mean, stats.max );
+}
+
+// Show the min for a latency stage
+static void formatLatencyMin( char *buf, enum eLatencyStage stage )
+{
+    struct sLatencyStats stats;
+    char *units = "us";
+
+    latencyRead( stage, &stats );
+    if( stats.min >= 10000 )
     {
-        if( unmuteDelay > 50 )
+        stats.min /= 1000;
+        units = "ms";
+    }
+
+    buf = formatText( buf, latencyName[stage] );
+    formatLabel( buf, "min ", stats.min, units );
+}
+
+// Show the histogram for a latency stage as one digit per bucket
+// from 1 to 9 scaled to the fullest bucket, blank if empty
+// e.g. "Pad [95 2    1]"
+static void formatLatencyHistogram( char *buf, enum eLatencyStage stage )
+{
+    struct sLatencyStats stats;
+    uint16_t fullest = 0;
+    uint8_t bucket;
+
+    latencyRead( stage, &stats );
+    for( bucket = 0 ; bucket < LATENCY_NUM_BUCKETS ; bucket++ )
+    {
+        if( stats.histogram[bucket] > fullest )
         {
-            unmuteDelay -= 50;
+            fullest = stats.histogram[bucket];
         }
-        else if( unmuteDelay > 0 )
+    }
+
+    buf = formatText( buf, latencyName[stage] );
+    buf = formatChar( buf, '[' );
+    for( bucket = 0 ; bucket < LATENCY_NUM_BUCKETS ; bucket++ )
+    {
+        uint16_t count = stats.histogram[bucket];
+        buf = formatChar( buf, count ? ('0' + ((uint32_t)count * 9 + fullest - 1) / fullest) : ' ' );
+    }
+    formatChar( buf, ']' );
+}
+
+#ifdef ENABLE_BUS_TRACE
+// Short names for the bus operations
+static const char *busOpName[NUM_BUS_OPS] =
+{
+    "Osc ",
+    "Tun ",
+    "Out ",
+    "LCD ",
+    "BL ",
+};
+
+// The devices on the bus and their short names
+static const uint8_t busDeviceAddress[NUM_BUS_DEVICES] =
+{
+    SI5351A_I2C_ADDRESS,
+    LCD_I2C_ADDRESS,
+};
+
+static const char *busDeviceName[NUM_BUS_DEVICES] =
+{
+    "Si ",
+    "LCD ",
+};
+
+// Letters for each I2C status in the error counts and trace
+static const char i2cStatusLetter[NUM_I2C_STATUS] =
+{
+    ' ',    // OK
+    'N',    // NAK
+    'A',    // Arbitration lost
+    'B',    // Bus error
+    'T',    // Timeout
+};
+
+// Show the mean and max time of some bus operations
+// Followed by ! if any of them failed
+static void formatBusCounts( char *buf, const char *name, struct sBusCounts *pCounts )
+{
+    buf = formatTimes( buf, name, pCounts->count ? (pCounts->totalTime / pCounts->count) : 0, pCounts->maxTime );
+    if( pCounts->failures )
+    {
+        formatChar( buf, '!' );
+    }
+}
+
+// Show the mean and max time for a bus operation
+static void formatBusOp( char *buf, enum eBusOp op )
+{
+    struct sBusCounts counts;
+
+    busTraceOpCounts( op, &counts );
+    formatBusCounts( buf, busOpName[op], &counts );
+}
+
+// Show the mean and max time for all the operations on a device
+static void formatBusDevice( char *buf, uint8_t device )
+{
+    struct sBusCounts counts;
+
+    busTraceDeviceCounts( busDeviceAddress[device], &counts );
+    formatBusCounts( buf, busDeviceName[device], &counts );
+}
+
+// Show the count of each error on a device e.g. "Si N2 A0 B0 T0"
+static void formatBusErrors( char *buf, uint8_t device )
+{
+    struct sBusCounts counts;
+
+    busTraceDeviceCounts( busDeviceAddress[device], &counts );
+    buf = formatText( buf, busDeviceName[device] );
+    for( uint8_t status = i2cStatusOK + 1 ; status < NUM_I2C_STATUS ; status++ )
+    {
+        buf = formatChar( buf, i2cStatusLetter[status] );
+        buf = formatUnsigned( buf, counts.errors[status], 1, ' ' );
+        if( status < (NUM_I2C_STATUS - 1) )
         {
-            unmuteDelay--;
+            buf = formatChar( buf, ' ' );
         }
-        bUsed = true;
     }
-    else if( bShortPress )
+}
+
+// Show a trace entry, newest first, e.g. "1 Tun 1234us N"
+static void formatBusTrace( char *buf, uint8_t entry )
+{
+    struct sBusTraceEntry trace;
+
+    buf = formatUnsigned( buf, entry + 1, 1, ' ' );
+    buf = formatChar( buf, ' ' );
+    if( busTraceRead( entry, &trace ) )
     {
-        unmuteDelay = 5;
-        bUsed = true;
+        buf = formatLabel( buf, busOpName[trace.op], (uint32_t)trace.duration * (1000000UL/64) / (TIMESTAMP_FREQ/64), "us " );
+        formatChar( buf, i2cStatusLetter[trace.status] );
+    }
+    else
+    {
+        formatChar( buf, '-' );
     }
-    char buf[TEXT_BUF_LEN];
-    sprintf( buf, "Unmute dly: %d", unmuteDelay);
-    displayText( MENU_LINE, buf, true );
-    
-    return bUsed;
 }
+#endif
 
-
-static bool menuMuteDelay( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+// Statistics for measuring the rig
+// Turn the rotary to step through the pages, short press to clear them all
+static bool menuStats( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
 {
     // Set to true if we have used the presses etc
     bool bUsed = false;
-    
+
     if( bCW )
     {
-        if( muteDelay < 50 )
-        {
-            muteDelay++;
-        }
-        else if( muteDelay < 500 )
-        {
-            muteDelay += 50;
-        }
+        statsPage = (statsPage + 1) % NUM_STATS_PAGES;
         bUsed = true;
     }
     else if( bCCW )
     {
-        if( muteDelay > 50 )
-        {
-            muteDelay -= 50;
-        }
-        else if( muteDelay > 0 )
-        {
-            muteDelay--;
-        }
+        statsPage = (statsPage + NUM_STATS_PAGES - 1) % NUM_STATS_PAGES;
         bUsed = true;
     }
     else if( bShortPress )
     {
-        muteDelay = 5;
+        latencyReset();
+        keyClockWrites = 0;
+        retunesSkipped = retunesPerformed = 0;
+        retunesFull = retunesFractional = 0;
+        synthResetByteCount();
+        displayCharsWritten = displayCharsSkipped = 0;
+#ifdef ENABLE_BUS_TRACE
+        busTraceReset();
+#endif
         bUsed = true;
     }
+
+    char buf[TEXT_BUF_LEN];
+    if( statsPage == statsKeyClock )
+    {
+        // Clock output enables written while keying
+        formatLabel( buf, "Key clk: ", keyClockWrites, "" );
+    }
+    else if( statsPage == statsTuneClock )
+    {
+        // Clocks programmed by the last retune
+        formatLabel( buf, "Tune clk: ", tuneClockWrites, "" );
+    }
+    else if( statsPage == statsRetunesSkipped )
+    {
+        // Clock retunes skipped because nothing changed
+        formatLabel( buf, "Tune skip: ", retunesSkipped, "" );
+    }
+    else if( statsPage == statsRetunesPerformed )
+    {
+        // Clock retunes that were written to the oscillator
+        formatLabel( buf, "Tune done: ", retunesPerformed, "" );
+    }
+    else if( statsPage == statsRetunesFull )
+    {
+        // Retunes that reset the PLL
+        formatLabel( buf, "PLL reset: ", retunesFull, "" );
+    }
+    else if( statsPage == statsRetunesFractional )
+    {
+        // Retunes that only changed the PLL numerator
+        formatLabel( buf, "PLL frac: ", retunesFractional, "" );
+    }
+    else if( statsPage == statsSynthBytes )
+    {
+        // Bytes on the I2C bus for writing and reading the oscillator
+        // registers directly
+        formatLabel( buf, "I2C: ", synthByteCount(), "B" );
+    }
+    else if( statsPage == statsDisplayUpdate )
+    {
+        // Characters written by the last display update
+        formatLabel( buf, "LCD last: ", updateChars, "" );
+    }
+    else if( statsPage == statsDisplayWritten )
+    {
+        // Characters written to the display
+        formatLabel( buf, "LCD wrote: ", displayCharsWritten, "" );
+    }
+    else if( statsPage == statsDisplaySkipped )
+    {
+        // Characters not written as they were already showing
+        formatLabel( buf, "LCD skip: ", displayCharsSkipped, "" );
+    }
+#ifdef ENABLE_BUS_TRACE
+    else if( statsPage >= statsBusTrace )
+    {
+        formatBusTrace( buf, statsPage - statsBusTrace );
+    }
+    else if( statsPage >= statsBusErrors )
+    {
+        formatBusErrors( buf, statsPage - statsBusErrors );
+    }
+    else if( statsPage >= statsBusDevice )
+    {
+        formatBusDevice( buf, statsPage - statsBusDevice );
+    }
+    else if( statsPage >= statsBusOp )
+    {
+        formatBusOp( buf, statsPage - statsBusOp );
+    }
+#endif
+    else if( statsPage >= statsLatencyHistogram )
+    {
+        formatLatencyHistogram( buf, statsPage - statsLatencyHistogram );
+    }
+    else if( statsPage >= statsLatencyMin )
+    {
+        formatLatencyMin( buf, statsPage - statsLatencyMin );
+    }
+    else
+    {
+        formatLatency( buf, statsPage - statsLatency );
+    }
+    writeLine( MENU_LINE, buf, true );
+
+    return bUsed;
+}
+
+static bool menuUnmuteDelay( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = adjustQSKDelay( &txSeqSettings.unmuteDelay, DEFAULT_UNMUTE_DELAY, nvramWriteUnmuteDelay, bCW, bCCW, bShortPress );
+
+    char buf[TEXT_BUF_LEN];
+    formatLabel( buf, "Unmute: ", txSeqSettings.unmuteDelay, "us" );
+    writeLine( MENU_LINE, buf, true );
+    
+    return bUsed;
+}
+
+
+static bool menuMuteDelay( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = adjustQSKDelay( &txSeqSettings.muteDelay, DEFAULT_MUTE_DELAY, nvramWriteMuteDelay, bCW, bCCW, bShortPress );
+
     char buf[TEXT_BUF_LEN];
-    sprintf( buf, "Mute dly: %d", muteDelay);
-    displayText( MENU_LINE, buf, true );
+    formatLabel( buf, "Mute: ", txSeqSettings.muteDelay, "us" );
+    writeLine( MENU_LINE, buf, true );
     
     return bUsed;
 }
@@ -1775,7 +2462,7 @@ static bool menuXtalFreq( bool bCW, bool bCCW, bool bShortPress, bool bLongPress
         xtalFreqPos = INITIAL_FREQ_POS;
         
         // Set the cursor on the digit to be changed
-        displayCursor( xtalFreqPos, MENU_LINE, cursorUnderline );
+        setCursor( xtalFreqPos, MENU_LINE, cursorUnderline );
 
         // We aren't asking to save the new frequency to NVRAM just yet
         bAskToSaveXtalFreq = false;
@@ -1788,7 +2475,7 @@ static bool menuXtalFreq( bool bCW, bool bCCW, bool bShortPress, bool bLongPress
         if( bLongPress )
         {
             // Set back the original frequency
-            oscSetXtalFrequency( nvramReadXtalFreq() );
+            setXtalFrequency( nvramReadXtalFreq() );
 
             // Retune to use the xtal frequency
             setFrequencies();
@@ -1815,10 +2502,10 @@ static bool menuXtalFreq( bool bCW, bool bCCW, bool bShortPress, bool bLongPress
         if( bLongPress )
         {
             // Don't want the cursor any more
-            displayCursor( 0, 0, cursorOff );
+            setCursor( 0, 0, cursorOff );
 
             // Set back the original frequency
-            oscSetXtalFrequency( nvramReadXtalFreq() );
+            setXtalFrequency( nvramReadXtalFreq() );
 
             // Retune to use the xtal frequency
             setFrequencies();
@@ -1837,9 +2524,9 @@ static bool menuXtalFreq( bool bCW, bool bCCW, bool bShortPress, bool bLongPress
                 bAskToSaveXtalFreq = true;
                 
                 // Don't want the cursor any more
-                displayCursor( 0, 0, cursorOff );
+                setCursor( 0, 0, cursorOff );
 
-                displayText( MENU_LINE, "Short press to save", true );
+                writeLine( MENU_LINE, "Short press to save", true );
             }
         }
         else
@@ -1882,7 +2569,7 @@ static bool menuXtalFreq( bool bCW, bool bCCW, bool bShortPress, bool bLongPress
                 }
 
                 // Set the cursor to the correct position for the current amount of change
-                displayCursor( xtalFreqPos, MENU_LINE, cursorUnderline );
+                setCursor( xtalFreqPos, MENU_LINE, cursorUnderline );
             }
             else if( bShortPressLeft )
             {
@@ -1901,19 +2588,19 @@ static bool menuXtalFreq( bool bCW, bool bCCW, bool bShortPress, bool bLongPress
                 }
 
                 // Set the cursor to the correct position for the current amount of change
-                displayCursor( xtalFreqPos, MENU_LINE, cursorUnderline );
+                setCursor( xtalFreqPos, MENU_LINE, cursorUnderline );
             }
 
             // Display the current frequency
             char buf[TEXT_BUF_LEN];
-            sprintf( buf, "Xtal: %0lu", newFreq);
-            displayText( MENU_LINE, buf, true );
+            formatLabel( buf, "Xtal: ", newFreq, "" );
+            writeLine( MENU_LINE, buf, true );
 
             // If the frequency is to change...
             if( newFreq != oldFreq )
             {
                 // Set it in the oscillator driver
-                oscSetXtalFrequency( newFreq );
+                setXtalFrequency( newFreq );
                 
                 // Set the RX and TX frequencies again - this will pick up the
                 // new crystal frequency
@@ -1962,16 +2649,16 @@ static bool menuKeyerMode( bool bCW, bool bCCW, bool bShortPress, bool bLongPres
     switch( keyerMode )
     {
         case morseKeyerIambicA:
-            displayText( MENU_LINE, "Keyer: Iambic A", true );
+            writeLine( MENU_LINE, "Keyer: Iambic A", true );
             break;
 
         case morseKeyerIambicB:
-            displayText( MENU_LINE, "Keyer: Iambic B", true );
+            writeLine( MENU_LINE, "Keyer: Iambic B", true );
             break;
 
         case morseKeyerUltimatic:
         default:
-            displayText( MENU_LINE, "Keyer: Ultimatic", true );
+            writeLine( MENU_LINE, "Keyer: Ultimatic", true );
             break;
     }
     
@@ -2028,16 +2715,16 @@ static bool menuBacklight( bool bCW, bool bCCW, bool bShortPress, bool bLongPres
     switch( backlightMode )
     {
         case backlightOff:
-            displayText( MENU_LINE, "Backlight: Off", true );
+            writeLine( MENU_LINE, "Backlight: Off", true );
             break;
 
         case backlightOn:
-            displayText( MENU_LINE, "Backlight: On", true );
+            writeLine( MENU_LINE, "Backlight: On", true );
             break;
 
         case backlightAuto:
         default:
-            displayText( MENU_LINE, "Backlight: Auto", true );
+            writeLine( MENU_LINE, "Backlight: Auto", true );
             break;
     }
 
@@ -2050,16 +2737,16 @@ static bool menuBacklight( bool bCW, bool bCCW, bool bShortPress, bool bLongPres
         switch( backlightMode )
         {
             case backlightOff:
-                lcdBacklight(false);
+                setBacklight( false );
                 break;
 
             case backlightOn:
-                lcdBacklight(true);
+                setBacklight( true );
                 break;
 
             case backlightAuto:
             default:
-                lcdBacklight(true);
+                setBacklight( true );
                 lastBacklightTime = millis();
                 break;
         }
@@ -2074,6 +2761,466 @@ static bool menuBacklight( bool bCW, bool bCCW, bool bShortPress, bool bLongPres
     return bUsed;
 }
 
+static bool menuMessageRepeat( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = false;
+
+    uint16_t repeat = nvramReadMessageRepeat();
+
+    if( bCW && (repeat < MAX_MESSAGE_REPEAT) )
+    {
+        repeat += MESSAGE_REPEAT_STEP;
+        bUsed = true;
+    }
+    else if( bCCW && (repeat > 0) )
+    {
+        repeat -= MESSAGE_REPEAT_STEP;
+        bUsed = true;
+    }
+    else if( bShortPress )
+    {
+        // Short press turns off repeating
+        repeat = 0;
+        bUsed = true;
+    }
+
+    if( bUsed )
+    {
+        nvramWriteMessageRepeat( repeat );
+    }
+
+    if( repeat )
+    {
+        char buf[TEXT_BUF_LEN];
+        formatLabel( buf, "Msg repeat: ", repeat, "s" );
+        writeLine( MENU_LINE, buf, true );
+    }
+    else
+    {
+        writeLine( MENU_LINE, "Msg repeat: Off", true );
+    }
+
+    return bUsed;
+}
+
+static bool menuSerial( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = false;
+
+    uint16_t serial = nvramReadSerial();
+
+    if( bCW )
+    {
+        serial++;
+        bUsed = true;
+    }
+    else if( bCCW && (serial > 1) )
+    {
+        serial--;
+        bUsed = true;
+    }
+    else if( bShortPress )
+    {
+        // Short press starts a new contest
+        serial = 1;
+        bUsed = true;
+    }
+
+    if( bUsed )
+    {
+        nvramWriteSerial( serial );
+    }
+
+    char buf[TEXT_BUF_LEN];
+    formatUnsigned( formatText( buf, "Serial: " ), serial, 3, '0' );
+    writeLine( MENU_LINE, buf, true );
+
+    return bUsed;
+}
+
+// Set the serial port speed for CAT control, a WinKeyer host or commands
+static void setPortBaud( enum ePortMode portMode )
+{
+    serialInit( (portMode == portWinkey) ? WINKEY_BAUD : SERIAL_BAUD );
+}
+
+// Turn to choose CAT control, WinKeyer or commands on the serial port
+static bool menuSerialPort( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = false;
+
+    enum ePortMode portMode = nvramReadPortMode();
+
+    if( bCW || bCCW )
+    {
+        if( bCW )
+        {
+            portMode = (portMode == NUM_PORT_MODES - 1) ? 0 : portMode + 1;
+        }
+        else
+        {
+            portMode = (portMode == 0) ? NUM_PORT_MODES - 1 : portMode - 1;
+        }
+        nvramWritePortMode( portMode );
+        setPortBaud( portMode );
+        bUsed = true;
+    }
+
+    if( portMode == portWinkey )
+    {
+        writeLine( MENU_LINE, "Port: WinKeyer", true );
+    }
+    else if( portMode == portCommand )
+    {
+        writeLine( MENU_LINE, "Port: Command", true );
+    }
+    else
+    {
+        writeLine( MENU_LINE, "Port: CAT", true );
+    }
+
+    return bUsed;
+}
+
+// Characters the rotary steps through when editing text
+static const char editChars[] = " ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789/?.,=#";
+#define NUM_EDIT_CHARS (sizeof( editChars ) - 1)
+
+// Text being edited, its length and the character being changed
+// The text is edited where it is, which is the NVRAM's edit buffer
+static char *editText;
+static uint8_t editLen;
+static uint8_t editPos;
+
+// Start editing text of up to len characters in a buffer of len + 1
+// The text is padded with spaces so that every position can be changed
+static void editStart( char *text, uint8_t len )
+{
+    bool bEnd = false;
+
+    for( uint8_t i = 0 ; i < len ; i++ )
+    {
+        if( text[i] == '\0' )
+        {
+            bEnd = true;
+        }
+        if( bEnd )
+        {
+            text[i] = ' ';
+        }
+    }
+    text[len] = '\0';
+
+    editText = text;
+    editLen = len;
+    editPos = 0;
+}
+
+// Show the text being edited with the cursor on the character being changed
+// The text scrolls so that the cursor stays on the display
+static void editShow()
+{
+    char buf[LCD_WIDTH + 1];
+    uint8_t start = (editPos < LCD_WIDTH) ? 0 : (editPos - LCD_WIDTH + 1);
+
+    strncpy( buf, &editText[start], LCD_WIDTH );
+    buf[LCD_WIDTH] = '\0';
+    writeLine( MENU_LINE, buf, true );
+
+    setCursor( editPos - start, MENU_LINE, cursorUnderline );
+}
+
+// The rotary changes the character and left and right move the cursor
+// Returns true if any of them were used
+static bool editControl( bool bCW, bool bCCW, bool bShortPressLeft, bool bShortPressRight )
+{
+    bool bUsed = true;
+
+    if( bCW || bCCW )
+    {
+        const char *p = strchr( editChars, editText[editPos] );
+        uint8_t i = p ? (p - editChars) : 0;
+
+        if( bCW )
+        {
+            i = (i + 1) % NUM_EDIT_CHARS;
+        }
+        else
+        {
+            i = (i + NUM_EDIT_CHARS - 1) % NUM_EDIT_CHARS;
+        }
+        editText[editPos] = editChars[i];
+    }
+    else if( bShortPressRight && (editPos < (editLen - 1)) )
+    {
+        editPos++;
+    }
+    else if( bShortPressLeft && (editPos > 0) )
+    {
+        editPos--;
+    }
+    else
+    {
+        bUsed = false;
+    }
+
+    return bUsed;
+}
+
+// Finished editing so remove the trailing spaces
+static void editFinish()
+{
+    while( (editLen > 0) && (editText[editLen - 1] == ' ') )
+    {
+        editText[--editLen] = '\0';
+    }
+}
+
+// Turn to choose a message and short press to edit it
+// When editing, a short press saves it and a long press leaves it unchanged
+static bool menuEditMessage( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = false;
+
+    static uint8_t message;
+    static bool bEditing;
+
+    // If just entered the menu start by choosing the message
+    if( !bCW && !bCCW && !bShortPress && !bLongPress && !bShortPressLeft && !bShortPressRight )
+    {
+        bEditing = false;
+    }
+
+    if( bEditing )
+    {
+        if( bShortPress )
+        {
+            editFinish();
+            messageWrite( message, editText );
+            bEditing = false;
+            bUsed = true;
+        }
+        else if( bLongPress )
+        {
+            // Back to choosing the message without saving
+            bEditing = false;
+            bUsed = true;
+        }
+        else
+        {
+            bUsed = editControl( bCW, bCCW, bShortPressLeft, bShortPressRight );
+        }
+
+        if( !bEditing )
+        {
+            setCursor( 0, 0, cursorOff );
+        }
+    }
+    else if( bCW )
+    {
+        message = (message + 1) % NUM_MESSAGES;
+        bUsed = true;
+    }
+    else if( bCCW )
+    {
+        message = (message + NUM_MESSAGES - 1) % NUM_MESSAGES;
+        bUsed = true;
+    }
+    else if( bShortPress )
+    {
+        editStart( nvramReadMessage( message ), MESSAGE_LEN );
+        bEditing = true;
+        bUsed = true;
+    }
+
+    if( bEditing )
+    {
+        editShow();
+    }
+    else
+    {
+        // Show the start of the message
+        char buf[TEXT_BUF_LEN];
+        char *p = formatChar( formatText( buf, "Msg " ), '1' + message );
+        p = formatText( p, ": " );
+        uint8_t i;
+        char c;
+        for( i = 0 ; (p < &buf[LCD_WIDTH]) && (c = nvramReadMessageChar( message, i )) ; i++ )
+        {
+            p = formatChar( p, c );
+        }
+        writeLine( MENU_LINE, buf, true );
+    }
+
+    return bUsed;
+}
+
+// The beacon interval set in the menu (2 minute slots)
+static uint8_t wsprInterval;
+
+// Turn to set the time between WSPR beacon transmissions
+// Short press at the start of an even minute to set the time
+static bool menuWsprBeacon( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = false;
+
+    if( bCW && (wsprInterval < WSPR_MAX_INTERVAL) )
+    {
+        wsprInterval++;
+        bUsed = true;
+    }
+    else if( bCCW && (wsprInterval > 0) )
+    {
+        wsprInterval--;
+        bUsed = true;
+    }
+    else if( bShortPress )
+    {
+        wsprSetTime( 0 );
+        bUsed = true;
+    }
+
+    if( bUsed )
+    {
+        wsprBeacon( wsprInterval );
+    }
+
+    char buf[TEXT_BUF_LEN];
+    char *p;
+    if( wsprInterval )
+    {
+        p = formatLabel( buf, "WSPR ", wsprInterval * 2, "m" );
+    }
+    else
+    {
+        p = formatText( buf, "WSPR Off" );
+    }
+    formatText( p, wsprTimeSet() ? " synced" : " no sync" );
+    writeLine( MENU_LINE, buf, true );
+
+    return bUsed;
+}
+
+// Layout of the WSPR message when shown and edited e.g. "K1ABC  FN42 37"
+#define WSPR_LOCATOR_POS    (WSPR_CALL_LEN + 1)
+#define WSPR_POWER_POS      (WSPR_LOCATOR_POS + WSPR_LOCATOR_LEN + 1)
+#define WSPR_MESSAGE_LEN    (WSPR_POWER_POS + 2)
+
+// Write the WSPR callsign, locator and power from the NVRAM
+static void formatWsprMessage( char *buf )
+{
+    char text[WSPR_CALL_LEN + 1];
+    char *p;
+
+    nvramReadWsprCall( text );
+    p = formatText( buf, text );
+    while( p < &buf[WSPR_LOCATOR_POS] )
+    {
+        p = formatChar( p, ' ' );
+    }
+
+    nvramReadWsprLocator( text );
+    p = formatChar( formatText( p, text ), ' ' );
+    formatUnsigned( p, nvramReadWsprPower(), 2, ' ' );
+}
+
+// Copy part of the text being edited without its spaces
+static void editField( uint8_t pos, uint8_t len, char *field )
+{
+    for( uint8_t i = pos ; i < (pos + len) ; i++ )
+    {
+        if( editText[i] != ' ' )
+        {
+            *field++ = editText[i];
+        }
+    }
+    *field = '\0';
+}
+
+// Short press to edit the WSPR callsign, locator and power
+// When editing, a short press saves them and a long press leaves them unchanged
+static bool menuWsprMessage( bool bCW, bool bCCW, bool bShortPress, bool bLongPress, bool bShortPressLeft, bool bLongPressLeft, bool bShortPressRight, bool bLongPressRight )
+{
+    // Set to true if we have used the presses etc
+    bool bUsed = false;
+
+    static bool bEditing;
+
+    // True if the last edit could not be sent in a WSPR message
+    static bool bInvalid;
+
+    char buf[TEXT_BUF_LEN];
+
+    // If just entered the menu show the current message
+    if( !bCW && !bCCW && !bShortPress && !bLongPress && !bShortPressLeft && !bShortPressRight )
+    {
+        bEditing = false;
+        bInvalid = false;
+    }
+
+    if( bEditing )
+    {
+        if( bShortPress )
+        {
+            char call[WSPR_CALL_LEN + 1];
+            char locator[WSPR_LOCATOR_LEN + 1];
+            char power[3];
+
+            editField( 0, WSPR_CALL_LEN, call );
+            editField( WSPR_LOCATOR_POS, WSPR_LOCATOR_LEN, locator );
+            editField( WSPR_POWER_POS, 2, power );
+            bInvalid = !wsprSetMessage( call, locator, atoi( power ) );
+            bEditing = false;
+            bUsed = true;
+        }
+        else if( bLongPress )
+        {
+            bEditing = false;
+            bUsed = true;
+        }
+        else
+        {
+            bUsed = editControl( bCW, bCCW, bShortPressLeft, bShortPressRight );
+        }
+
+        if( !bEditing )
+        {
+            setCursor( 0, 0, cursorOff );
+        }
+    }
+    else if( bShortPress )
+    {
+        char *text = nvramEditBuffer();
+
+        formatWsprMessage( text );
+        editStart( text, WSPR_MESSAGE_LEN );
+        bEditing = true;
+        bInvalid = false;
+        bUsed = true;
+    }
+
+    if( bEditing )
+    {
+        editShow();
+    }
+    else if( bInvalid )
+    {
+        writeLine( MENU_LINE, "Invalid message", true );
+    }
+    else
+    {
+        formatWsprMessage( buf );
+        writeLine( MENU_LINE, buf, true );
+    }
+
+    return bUsed;
+}
+
 // Gets a VFO frequency - usually called from CAT control
 uint32_t getVFOFreq( uint8_t vfo )
 {
@@ -2158,7 +3305,6 @@ void setCurrentVFO( uint8_t vfo )
 
         // Update the frequencies and display
         setFrequencies();
-        update_display();
     }
 }
 
@@ -2171,8 +3317,71 @@ bool getVFOSplit()
 // Get the transmitting state - for CAT control
 bool getTransmitting()
 {
-    return bTransmitting;
+    return txSeqTransmitting();
+}
+
+// The TX frequency taking account of split and XIT - for the FSK driver
+uint32_t getTXFrequency()
+{
+    return getTXFreq();
 }
+
+// Work out the TX clock setting for an FSK tone (mHz) - for the FSK driver
+// The TX clock is put on the TX frequency first so that it is on its
+// own PLL, which is what the tone changes.
+// Returns false if the TX clock cannot be retuned by its PLL alone.
+bool makeTXTone( uint64_t freq, struct sSynthTone *pTone )
+{
+    setTXClock( getTXFreq() );
+
+    return bTXDirect && synthMakeTone( &txGroup, freq, pTone );
+}
+
+// Write an FSK tone to the TX clock's PLL
+static bool writeTXTone( const struct sSynthTone *pTone )
+{
+    bool bOK;
+
+    BUS_TRACE_START( start );
+    bOK = synthSetTone( &txGroup, pTone );
+    BUS_TRACE_END( busOpTune, start, synthBusStatus() );
+
+    return bOK;
+}
+
+// Set the TX clock to an FSK tone - for the FSK driver
+// If the oscillator driver has used the chip since the tones were made
+// the TX clock is taken over again and the tone tried once more.
+// Returns false if the tone could not be set.
+bool setTXTone( const struct sSynthTone *pTone )
+{
+    bool bOK = writeTXTone( pTone );
+
+    if( !bOK )
+    {
+        setTXClock( getTXFreq() );
+        bOK = bTXDirect && writeTXTone( pTone );
+    }
+
+    if( bOK )
+    {
+        // The TX clock is no longer on a whole number of Hz so must
+        // be written when it is next set
+        clockSettings[TX_CLOCK].freq = 0;
+        tuneClockWrites++;
+        retunesPerformed++;
+        retunesFractional++;
+    }
+
+    return bOK;
+}
+
+// Put the TX clock back to the TX frequency after FSK - for the FSK driver
+void restoreTXClock()
+{
+    setTXClock( getTXFreq() );
+}
+
 #endif
 
 // Adjust a VFO. Changes the frequency or the offset by the supplied change.
@@ -2483,7 +3692,7 @@ static void handleRotary()
         // If we have an auto backlight then turn it on and note the time
         if( currentBacklightMode == backlightAuto )
         {
-            lcdBacklight( true );
+            setBacklight( true );
             lastBacklightTime = millis();
         }
 
@@ -2511,9 +3720,38 @@ static void handleRotary()
 }
 
 
+// Draw the display if it has changed and it is at least DISPLAY_INTERVAL
+// since it was last drawn
+static void displayScan()
+{
+    if( bDisplayDirty && ((millis() - lastDisplayTime) >= DISPLAY_INTERVAL) )
+    {
+        bDisplayDirty = false;
+        lastDisplayTime = millis();
+        draw_display();
+
+#ifndef SOTA2
+        // Drawing moves the cursor so put it back
+        if( cursorType != cursorOff )
+        {
+            displayCursor( cursorCol, cursorLine, cursorType );
+        }
+#endif
+    }
+}
+
 // Main loop is called repeatedly
 static void loop()
 {
+    // Move on any TX/RX switching that is in progress
+    txSequencer();
+
+#ifndef SOTA2
+    // Keep any FSK transmission going and its symbol timing measured
+    fskScan();
+    ioCalibrateTimestamp();
+#endif
+
 #ifndef SOTA2
     // If the backlight mode is auto then see if it is time
     // to turn off the backlight
@@ -2522,7 +3760,7 @@ static void loop()
         if( lastBacklightTime &&
             (millis() - lastBacklightTime) > BACKLIGHT_AUTO_DELAY )
         {
-            lcdBacklight( false );
+            setBacklight( false );
 
             // Setting this to zero stops us checking any more
             lastBacklightTime = 0;
@@ -2531,15 +3769,57 @@ static void loop()
 #endif
 
     // See if the morse paddles or straight key have been pressed
+    // The keyer sends from the paddles unless in straight key mode
+    bool bKeying = keyerScanPaddles();
+    if( morseGetWpm() == 0 )
+    {
+        bKeying = morseScanPaddles();
+    }
+
+#ifndef SOTA2
+    // The paddles or key take over from any FSK transmission
+    if( bKeying )
+    {
+        fskAbort();
+    }
+#endif
+
     // If not active then deal with other things too
-	if( !morseScanPaddles() )
+	if( !bKeying )
     {
-        // Deal with the rotary control/pushbutton
-        handleRotary();
+#ifndef SOTA2
+        // Deal with the rotary control/pushbutton and the display unless
+        // sending FSK. The rotary could retune the TX clock away from a
+        // tone and a display update would hold up the next symbol.
+        if( !fskSending() )
+#endif
+        {
+            handleRotary();
+
+            // Bring the display up to date
+            displayScan();
+        }
 
 #ifndef SOTA2
-        // Do CAT control
-        catControl();
+        // The serial port is for CAT control, a WinKeyer host or commands
+        if( nvramReadPortMode() == portWinkey )
+        {
+            winkeyControl();
+        }
+        else if( nvramReadPortMode() == portCommand )
+        {
+            commandControl();
+        }
+        else
+        {
+            catControl();
+        }
+
+        // Keep any message memory going
+        messageScan();
+
+        // Start a WSPR beacon transmission when due
+        wsprScan();
 #endif
     }
 }
@@ -2563,6 +3843,12 @@ int main(void)
 #ifndef SOTA2
     // Initialise CAT control
     catInit();
+
+    // WinKeyer hosts need the port at their speed
+    if( nvramReadPortMode() == portWinkey )
+    {
+        setPortBaud( portWinkey );
+    }
 #endif
 
     // Set up morse and set the speed and keyer mode as read from NVRAM
@@ -2570,12 +3856,17 @@ int main(void)
     morseSetWpm( nvramReadWpm() );
     morseSetKeyerMode( nvramReadMorseKeyerMode() );
 
+    // Get the TX/RX switching delays from NVRAM
+    txSeqSettings.muteDelay = nvramReadMuteDelay();
+    txSeqSettings.unmuteDelay = nvramReadUnmuteDelay();
+    txSeqSettings.txDelay = nvramReadTXDelay();
+
 #ifndef SOTA2
     displayInit();
 
     // Set the backlight
     currentBacklightMode = nvramReadBacklighMode();
-    lcdBacklight( currentBacklightMode != backlightOff );
+    setBacklight( currentBacklightMode != backlightOff );
     if( currentBacklightMode == backlightAuto )
     {
         lastBacklightTime = millis();
@@ -2583,10 +3874,14 @@ int main(void)
 #endif
    
     // Initialise the oscillator chip
+    BUS_TRACE_START( oscInitStart );
 	bOscInit = oscInit();
 
+    // oscInit() fails if the oscillator does not answer
+    BUS_TRACE_END( busOpOscInit, oscInitStart, bOscInit ? ioI2CLibraryStatus() : i2cStatusNak );
+
     // Load the crystal frequency from NVRAM
-    oscSetXtalFrequency( nvramReadXtalFreq() );
+    setXtalFrequency( nvramReadXtalFreq() );
 
     // Set the band from the NVRAM
     // This also updates the display with frequency and wpm.
@@ -43,4 +43,21 @@ void     displayMorse( char *text );
 
 void     keyDown( bool bDown );
 
+// Keyer driver
+// Key down or up from the keyer timer interrupt
+// The clocks are switched later from the main loop
+void     keyDownInterrupt( bool bDown );
+
+// FSK driver
+struct sSynthTone;
+uint32_t getTXFrequency();
+bool     makeTXTone( uint64_t freq, struct sSynthTone *pTone );
+bool     setTXTone( const struct sSynthTone *pTone );
+void     restoreTXClock();
+
+// Sequencer driver
+// Switch the clock outputs over for TX or RX
+// Returns true if the TX clock is on
+bool     setTXRXClocks( bool bTX );
+
 #endif /* MAIN_H_ */
\ No newline at end of file
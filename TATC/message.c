@@ -0,0 +1,195 @@
+/*
+ * message.c
+ *
+ * Sends the message memories from the EEPROM through the keyer.
+ * The text is fed into the keyer's queue a few characters at a
+ * time from the main loop so that nothing waits for the sending.
+ *
+ * The serial number token is replaced by the contest serial number
+ * which goes up by one each time a message containing it is sent.
+ * Messages can repeat at an interval for beacon use.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+
+#include "config.h"
+#include "format.h"
+#include "keyer.h"
+#include "message.h"
+#include "millis.h"
+#include "morse.h"
+#include "nvram.h"
+
+#ifndef SOTA2
+
+// Used when no message is being sent
+#define NO_MESSAGE 0xFF
+
+// The message being sent and the next character to queue
+static uint8_t currentMessage = NO_MESSAGE;
+static uint8_t messagePos;
+
+// The serial number as text while it is being queued
+// serialPos is the next digit or 0 when not queueing it
+static char serialText[6];
+static uint8_t serialPos;
+
+// True if the serial number has been sent in this message
+static bool bSentSerial;
+
+// True once the whole message has been queued
+static bool bAllQueued;
+
+// The keyer's paddle press count when the message started
+static uint8_t paddlePresses;
+
+// True when waiting to repeat the message and the time it finished (ms)
+static bool bWaitingToRepeat;
+static uint32_t finishTime;
+
+// Start sending a message memory
+// Does nothing in straight key mode
+void messageSend( uint8_t message )
+{
+    keyerClearQueue();
+    currentMessage = NO_MESSAGE;
+
+    if( (message < NUM_MESSAGES) && (morseGetWpm() != 0) )
+    {
+        // Only a paddle press from now on stops the message
+        paddlePresses = keyerPaddlePresses();
+
+        currentMessage = message;
+        messagePos = 0;
+        serialPos = 0;
+        bSentSerial = false;
+        bAllQueued = false;
+        bWaitingToRepeat = false;
+    }
+}
+
+// Stop sending the current message
+void messageStop()
+{
+    keyerClearQueue();
+    currentMessage = NO_MESSAGE;
+}
+
+// True if a message is being sent or waiting to repeat
+bool messageSending()
+{
+    return currentMessage != NO_MESSAGE;
+}
+
+// Change a message memory - from the edit menu
+void messageWrite( uint8_t message, const char *text )
+{
+    nvramWriteMessage( message, text );
+}
+
+// Get the next character of the message to queue
+// Returns 0 at the end of the message
+static char nextMessageChar()
+{
+    char c = 0;
+    bool bFound = false;
+
+    while( !bFound )
+    {
+        if( serialPos )
+        {
+            // Part way through the serial number
+            c = serialText[serialPos - 1];
+            if( c )
+            {
+                serialPos++;
+                bFound = true;
+            }
+            else
+            {
+                serialPos = 0;
+            }
+        }
+        else
+        {
+            c = nvramReadMessageChar( currentMessage, messagePos++ );
+            if( c == MESSAGE_SERIAL_TOKEN )
+            {
+                formatUnsigned( serialText, nvramReadSerial(), 3, '0' );
+                serialPos = 1;
+                bSentSerial = true;
+            }
+            else
+            {
+                bFound = true;
+            }
+        }
+    }
+
+    return c;
+}
+
+// Keep the keyer supplied with text - call from the main loop
+void messageScan()
+{
+    char c;
+
+    // A paddle press stops the message altogether, including
+    // while waiting to repeat it
+    if( (currentMessage != NO_MESSAGE) && (keyerPaddlePresses() != paddlePresses) )
+    {
+        messageStop();
+    }
+
+    if( currentMessage != NO_MESSAGE )
+    {
+        if( bWaitingToRepeat )
+        {
+            // Start again once the repeat interval has passed
+            if( (millis() - finishTime) >= nvramReadMessageRepeat() * 1000UL )
+            {
+                messageSend( currentMessage );
+            }
+        }
+        else if( !bAllQueued )
+        {
+            // Top up the keyer's queue
+            while( !bAllQueued && keyerQueueSpace() )
+            {
+                c = nextMessageChar();
+                if( c )
+                {
+                    keyerQueueChar( c );
+                }
+                else
+                {
+                    bAllQueued = true;
+                }
+            }
+        }
+        else if( !keyerSendingText() )
+        {
+            // Finished sending so move on to the next serial number
+            if( bSentSerial )
+            {
+                nvramWriteSerial( nvramReadSerial() + 1 );
+                bSentSerial = false;
+            }
+
+            if( nvramReadMessageRepeat() )
+            {
+                bWaitingToRepeat = true;
+                finishTime = millis();
+            }
+            else
+            {
+                currentMessage = NO_MESSAGE;
+            }
+        }
+    }
+}
+
+#endif
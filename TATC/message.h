@@ -0,0 +1,30 @@
+/*
+ * message.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef MESSAGE_H
+#define MESSAGE_H
+
+#include <inttypes.h>
+
+// Start sending a message memory
+// Does nothing in straight key mode
+void messageSend( uint8_t message );
+
+// Stop sending the current message
+void messageStop();
+
+// True if a message is being sent or waiting to repeat
+bool messageSending();
+
+// Change a message memory - from the edit menu
+void messageWrite( uint8_t message, const char *text );
+
+// Keep the keyer supplied with text - call from the main loop
+void messageScan();
+
+#endif //MESSAGE_H
@@ -12,6 +12,7 @@
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 #include <ctype.h>
+#include <string.h>
 
 #include "config.h"
 #include "eeprom.h"
@@ -199,10 +200,38 @@ uint8_t nvramReadCWReverse()
     return false;
 }
 
+// The TX/RX switching delays are not stored so use the defaults
+uint16_t nvramReadMuteDelay()
+{
+    return DEFAULT_MUTE_DELAY;
+}
+
+uint16_t nvramReadUnmuteDelay()
+{
+    return DEFAULT_UNMUTE_DELAY;
+}
+
+uint16_t nvramReadTXDelay()
+{
+    return DEFAULT_TX_DELAY;
+}
+
 #else
 
 // Magic number used to help verify the data is correct
-#define MAGIC 0x8402
+#define MAGIC 0x8405
+
+// The message memories are in the EEPROM after the cache
+// but are not cached to save RAM
+#define MESSAGE_ADDRESS 64
+
+static const char *const defaultMessage[NUM_MESSAGES] =
+{
+    DEFAULT_MESSAGE_0,
+    DEFAULT_MESSAGE_1,
+    DEFAULT_MESSAGE_2,
+    DEFAULT_MESSAGE_3,
+};
 
 // Cached version of the NVRAM - read from the EEPROM at boot time
 static struct
@@ -214,6 +243,15 @@ static struct
     uint8_t band;                           // Frequency band
     bool bCWReverse;                        // True if in CW-Reverse
     enum eBacklightMode backlight_mode;     // Backlight mode
+    uint16_t mute_delay;                    // Delay after muting RX (us)
+    uint16_t unmute_delay;                  // Delay before unmuting RX (us)
+    uint16_t tx_delay;                      // Delay after TX clock on and before PA off (us)
+    uint16_t serial;                        // Contest serial number
+    uint16_t message_repeat;                // Message repeat interval (s)
+    enum ePortMode port_mode;               // What the serial port is used for
+    char     wspr_call[WSPR_CALL_LEN];      // WSPR callsign - 0 padded
+    char     wspr_locator[WSPR_LOCATOR_LEN];// WSPR locator
+    uint8_t  wspr_power;                    // WSPR power (dBm)
     uint16_t crc;                           // CRC to check that the data is valid
 } nvram_cache;
 
@@ -273,9 +311,23 @@ void nvramInit()
         nvram_cache.bCWReverse = DEFAULT_CWREVERSE;
         nvram_cache.magic = MAGIC;
         nvram_cache.backlight_mode = DEFAULT_BACKLIGHT_MODE;
+        nvram_cache.mute_delay = DEFAULT_MUTE_DELAY;
+        nvram_cache.unmute_delay = DEFAULT_UNMUTE_DELAY;
+        nvram_cache.tx_delay = DEFAULT_TX_DELAY;
+        nvram_cache.serial = 1;
+        nvram_cache.message_repeat = 0;
+        nvram_cache.port_mode = DEFAULT_PORT_MODE;
+        strncpy( nvram_cache.wspr_call, WSPR_DEFAULT_CALL, WSPR_CALL_LEN );
+        strncpy( nvram_cache.wspr_locator, WSPR_DEFAULT_LOCATOR, WSPR_LOCATOR_LEN );
+        nvram_cache.wspr_power = WSPR_DEFAULT_POWER;
         
         // Calculate the CRC and write to the EEPROM
         nvramUpdate();
+
+        for( uint8_t i = 0 ; i < NUM_MESSAGES ; i++ )
+        {
+            nvramWriteMessage( i, defaultMessage[i] );
+        }
     }
 }
 
@@ -348,4 +400,170 @@ void nvramWriteBacklightMode( enum eBacklightMode backlight_mode )
     nvramUpdate();
 }
 
+uint16_t nvramReadMuteDelay()
+{
+    return nvram_cache.mute_delay;
+}
+
+void nvramWriteMuteDelay( uint16_t delay )
+{
+    nvram_cache.mute_delay = delay;
+    nvramUpdate();
+}
+
+uint16_t nvramReadUnmuteDelay()
+{
+    return nvram_cache.unmute_delay;
+}
+
+void nvramWriteUnmuteDelay( uint16_t delay )
+{
+    nvram_cache.unmute_delay = delay;
+    nvramUpdate();
+}
+
+uint16_t nvramReadTXDelay()
+{
+    return nvram_cache.tx_delay;
+}
+
+void nvramWriteTXDelay( uint16_t delay )
+{
+    nvram_cache.tx_delay = delay;
+    nvramUpdate();
+}
+
+// Buffer for text being edited - a whole message memory or text made
+// from other settings. Only one thing is edited at a time.
+static char edit_buffer[MESSAGE_LEN + 1];
+
+// The buffer for text being edited e.g. the WSPR message
+char *nvramEditBuffer()
+{
+    return edit_buffer;
+}
+
+// Read a whole message memory into the edit buffer
+// Returns the edit buffer
+char *nvramReadMessage( uint8_t message )
+{
+    for( uint8_t i = 0 ; i < MESSAGE_LEN ; i++ )
+    {
+        edit_buffer[i] = nvramReadMessageChar( message, i );
+    }
+    edit_buffer[MESSAGE_LEN] = '\0';
+
+    return edit_buffer;
+}
+
+// Message memories are read a character at a time to save RAM
+// Returns 0 after the end of the message
+char nvramReadMessageChar( uint8_t message, uint8_t pos )
+{
+    char c = 0;
+
+    if( (message < NUM_MESSAGES) && (pos < MESSAGE_LEN) )
+    {
+        c = eepromRead( MESSAGE_ADDRESS + message * MESSAGE_LEN + pos );
+    }
+
+    return c;
+}
+
+// Only writes changed bytes to minimise EEPROM wear
+// Shorter messages are terminated with a 0
+void nvramWriteMessage( uint8_t message, const char *text )
+{
+    bool bEnd = false;
+    char c;
+
+    if( message < NUM_MESSAGES )
+    {
+        for( uint8_t i = 0 ; i < MESSAGE_LEN ; i++ )
+        {
+            c = bEnd ? 0 : text[i];
+            if( c == 0 )
+            {
+                bEnd = true;
+            }
+
+            uint16_t address = MESSAGE_ADDRESS + message * MESSAGE_LEN + i;
+            if( eepromRead( address ) != c )
+            {
+                eepromWrite( address, c );
+            }
+        }
+    }
+}
+
+uint16_t nvramReadSerial()
+{
+    return nvram_cache.serial;
+}
+
+void nvramWriteSerial( uint16_t serial )
+{
+    nvram_cache.serial = serial;
+    nvramUpdate();
+}
+
+uint16_t nvramReadMessageRepeat()
+{
+    return nvram_cache.message_repeat;
+}
+
+void nvramWriteMessageRepeat( uint16_t repeat )
+{
+    nvram_cache.message_repeat = repeat;
+    nvramUpdate();
+}
+
+enum ePortMode nvramReadPortMode()
+{
+    return nvram_cache.port_mode;
+}
+
+void nvramWritePortMode( enum ePortMode mode )
+{
+    nvram_cache.port_mode = mode;
+    nvramUpdate();
+}
+
+// The WSPR callsign and locator are returned with a terminating 0
+// so the buffers must have room for it
+void nvramReadWsprCall( char *call )
+{
+    strncpy( call, nvram_cache.wspr_call, WSPR_CALL_LEN );
+    call[WSPR_CALL_LEN] = 0;
+}
+
+void nvramWriteWsprCall( const char *call )
+{
+    strncpy( nvram_cache.wspr_call, call, WSPR_CALL_LEN );
+    nvramUpdate();
+}
+
+void nvramReadWsprLocator( char *locator )
+{
+    strncpy( locator, nvram_cache.wspr_locator, WSPR_LOCATOR_LEN );
+    locator[WSPR_LOCATOR_LEN] = 0;
+}
+
+void nvramWriteWsprLocator( const char *locator )
+{
+    strncpy( nvram_cache.wspr_locator, locator, WSPR_LOCATOR_LEN );
+    nvramUpdate();
+}
+
+uint8_t nvramReadWsprPower()
+{
+    return nvram_cache.wspr_power;
+}
+
+void nvramWriteWsprPower( uint8_t power )
+{
+    nvram_cache.wspr_power = power;
+    nvramUpdate();
+}
+
 #endif
\ No newline at end of file
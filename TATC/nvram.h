@@ -21,6 +21,15 @@ enum eBacklightMode
     NUM_BACKLIGHT_MODES
 };
 
+// What the serial port is used for
+enum ePortMode
+{
+    portCAT = 0,
+    portWinkey,
+    portCommand,
+    NUM_PORT_MODES
+};
+
 void nvramInit();
 
 uint8_t nvramReadWpm();
@@ -41,4 +50,46 @@ void nvramWriteCWReverse( bool bCWReverse );
 enum eBacklightMode nvramReadBacklighMode();
 void nvramWriteBacklightMode( enum eBacklightMode );
 
+uint16_t nvramReadMuteDelay();
+void nvramWriteMuteDelay( uint16_t delay );
+
+uint16_t nvramReadUnmuteDelay();
+void nvramWriteUnmuteDelay( uint16_t delay );
+
+uint16_t nvramReadTXDelay();
+void nvramWriteTXDelay( uint16_t delay );
+
+#ifndef SOTA2
+// Message memories are read a character at a time to save RAM
+// Returns 0 after the end of the message
+char nvramReadMessageChar( uint8_t message, uint8_t pos );
+
+// A whole message memory is read into a buffer kept for text being
+// edited, which is returned. The buffer has room for MESSAGE_LEN
+// characters and the terminating 0.
+char *nvramReadMessage( uint8_t message );
+char *nvramEditBuffer();
+void nvramWriteMessage( uint8_t message, const char *text );
+
+uint16_t nvramReadSerial();
+void nvramWriteSerial( uint16_t serial );
+
+uint16_t nvramReadMessageRepeat();
+void nvramWriteMessageRepeat( uint16_t repeat );
+
+enum ePortMode nvramReadPortMode();
+void nvramWritePortMode( enum ePortMode mode );
+
+// The WSPR callsign and locator are returned with a terminating 0
+// so the buffers must have room for it
+void nvramReadWsprCall( char *call );
+void nvramWriteWsprCall( const char *call );
+
+void nvramReadWsprLocator( char *locator );
+void nvramWriteWsprLocator( const char *locator );
+
+uint8_t nvramReadWsprPower();
+void nvramWriteWsprPower( uint8_t power );
+#endif
+
 #endif //NVRAM_H
@@ -0,0 +1,387 @@
+/*
+ * sequencer.c
+ *
+ * Switches between RX and TX when the key goes up and down - muting
+ * the RX, swapping the RX and TX clocks, turning the PA and sidetone
+ * on and off - with the delays between each step timed by the
+ * sequence timer interrupt.
+ *
+ * The steps that only change I/O pins are taken in the interrupt so
+ * that their timing is accurate. Swapping the clocks needs the I2C
+ * bus so is left to the main loop, which calls back to main.c to
+ * program the oscillator.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "io.h"
+#include "latency.h"
+#include "main.h"
+#include "sequencer.h"
+
+// Settings - changed by the menus
+struct sTXSeqSettings txSeqSettings =
+{
+    .bBreakIn = true,
+    .hangTime = DEFAULT_HANG_TIME,
+    .bRXClockEnabled = true,
+    .bTXClockEnabled = true,
+    .bTXOutEnabled = true,
+    .bSidetone = true,
+};
+
+// Set to true when transmitting
+static volatile bool bTransmitting = false;
+
+// Steps in switching between RX and TX
+static volatile enum eTXSequence
+{
+    txSeqRX,        // Receiving
+    txSeqMute,      // RX muted, waiting to swap the clocks
+    txSeqTXClock,   // TX clock on, waiting to turn on the PA
+    txSeqTX,        // Transmitting
+    txSeqKeyUp,     // Key up, waiting to turn off the PA
+    txSeqHang,      // Semi break in, PA off, waiting for the hang time
+    txSeqPAOff,     // PA off, waiting to turn off the TX clock
+    txSeqUnmute,    // RX clock on, waiting to unmute the RX
+} txSeqState = txSeqRX;
+
+// Set by the sequence timer interrupt when the clocks need switching
+static volatile bool bTXSeqClocksDue;
+
+// Timestamp of the start of the semi break in hang time
+static uint16_t hangTimestamp;
+
+// The key state as last set by txSeqKeyDown()
+static volatile bool bKeyIsDown;
+
+// Timestamp of the last key down for measuring the keying latency
+// and true until the PA has gone on
+static uint16_t keyDownTimestamp;
+static volatile bool bTimingKeyDown;
+
+// If the key goes down again before the PA has gone off, the time
+// between the PA going off and on again (us)
+static uint16_t txSeqGap;
+
+// Mute or unmute the RX
+void txSeqMuteRX( bool bMute )
+{
+    if( bMute )
+    {
+        ioWriteRXEnableLow();
+    }
+    else
+    {
+        ioWriteRXEnableHigh();
+    }
+}
+
+static void sidetoneOn( bool bOn )
+{
+    if( txSeqSettings.bSidetone )
+    {
+        if( bOn )
+        {
+            ioWriteSidetoneOn();
+        }
+        else
+        {
+            ioWriteSidetoneOff();
+        }
+    }
+}
+
+// Move to the next step of the TX/RX sequence after waiting the supplied
+// number of us. The sequence timer interrupt calls txSequencerTimer() when
+// the wait is over. With no wait the step is taken straight away.
+// Must be called with interrupts disabled or from an interrupt.
+static void txSeqNext( enum eTXSequence state, uint16_t wait )
+{
+    txSeqState = state;
+
+    if( wait )
+    {
+        ioStartSequenceTimer( wait );
+    }
+    else
+    {
+        txSequencerTimer();
+    }
+}
+
+// Called from the sequence timer interrupt when the wait for the current
+// step of the TX/RX sequence is over. Only the steps that change I/O pins
+// are taken here so that the mute, PA and sidetone edges are accurate.
+// Switching the clocks needs the I2C bus so is left to the main loop.
+//
+// Key down: mute RX, wait txSeqSettings.muteDelay, RX clock off and TX clock on, wait txSeqSettings.txDelay,
+//           PA on and sidetone on
+// Key up:   wait txSeqSettings.muteDelay and txSeqSettings.txDelay so that the dot or dash is not truncated,
+//           PA off and sidetone off, wait txSeqSettings.txDelay, TX clock off and RX clock on,
+//           wait txSeqSettings.unmuteDelay, unmute RX
+void txSequencerTimer()
+{
+    switch( txSeqState )
+    {
+        case txSeqTXClock:
+            if( txSeqSettings.bBreakIn )
+            {
+                // Set the morse output high
+                if( txSeqSettings.bTXOutEnabled )
+                {
+                    ioWriteMorseOutputHigh();
+                }
+                bTransmitting = true;
+            }
+
+            // Turn on sidetone
+            sidetoneOn( true );
+
+            // Record how long it took from key down
+            if( bTimingKeyDown )
+            {
+                latencyRecord( latencyPA, ioReadTimestamp() - keyDownTimestamp );
+                bTimingKeyDown = false;
+            }
+
+            txSeqState = txSeqTX;
+
+            // The key may have come up while we were getting ready
+            if( !bKeyIsDown )
+            {
+                txSeqNext( txSeqKeyUp, txSeqSettings.muteDelay + (txSeqSettings.bBreakIn ? txSeqSettings.txDelay : 0) );
+            }
+            break;
+
+        case txSeqKeyUp:
+            // Set the morse output low and turn off sidetone
+            ioWriteMorseOutputLow();
+            sidetoneOn( false );
+
+            if( bKeyIsDown )
+            {
+                // Key went down again before the PA went off so the TX
+                // clock is still on and only the PA needs turning on again
+                txSeqNext( txSeqTXClock, txSeqGap );
+            }
+            else if( txSeqSettings.bBreakIn && txSeqSettings.bSemiBreakIn )
+            {
+                // Stay in TX in case the key goes down again
+                hangTimestamp = ioReadTimestamp();
+                txSeqState = txSeqHang;
+            }
+            else
+            {
+                txSeqNext( txSeqPAOff, txSeqSettings.bBreakIn ? txSeqSettings.txDelay : 0 );
+            }
+            break;
+
+        case txSeqUnmute:
+            if( !txSeqSettings.bTestRXMute )
+            {
+                // Unmute the RX last
+                txSeqMuteRX( false );
+            }
+            txSeqState = txSeqRX;
+            break;
+
+        case txSeqMute:
+        case txSeqPAOff:
+            // The clocks need switching so leave it to the main loop
+            bTXSeqClocksDue = true;
+            break;
+
+        case txSeqRX:
+        case txSeqTX:
+        default:
+            break;
+    }
+}
+
+// Called from the main loop to take the steps of the TX/RX sequence that
+// switch the clocks over I2C.
+void txSequencer()
+{
+    // Go back to RX once the semi break in hang time has passed
+    if( txSeqState == txSeqHang )
+    {
+        ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+        {
+            if( (txSeqState == txSeqHang) &&
+                ((uint16_t)(ioReadTimestamp() - hangTimestamp) >= (uint16_t)((uint32_t)txSeqSettings.hangTime * TIMESTAMP_FREQ / 1000)) )
+            {
+                txSeqState = txSeqPAOff;
+                bTXSeqClocksDue = true;
+            }
+        }
+    }
+
+    if( bTXSeqClocksDue )
+    {
+        bTXSeqClocksDue = false;
+
+        switch( txSeqState )
+        {
+            case txSeqMute:
+            {
+                // Swap the RX clock for the TX clock in one go
+                // Time the switch itself and from key down
+                uint16_t switchTimestamp = ioReadTimestamp();
+                bool bTXClockOn = setTXRXClocks( true );
+                uint16_t clocksTimestamp = ioReadTimestamp();
+                latencyRecord( latencyClockSwitch, clocksTimestamp - switchTimestamp );
+                latencyRecord( latencyClocks, clocksTimestamp - keyDownTimestamp );
+
+                // The keyer interrupt may have moved the sequence on while
+                // the clocks were being switched
+                ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+                {
+                    if( txSeqState == txSeqMute )
+                    {
+                        txSeqNext( txSeqTXClock, bTXClockOn ? txSeqSettings.txDelay : 0 );
+                    }
+                }
+                break;
+            }
+
+            case txSeqPAOff:
+            {
+                // Swap the TX clock for the RX clock in one go
+                bool bKeyedAgain = false;
+
+                setTXRXClocks( false );
+
+                // The key may have gone down again while the clocks were
+                // being switched
+                ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+                {
+                    if( txSeqState == txSeqPAOff )
+                    {
+                        bTransmitting = false;
+                        txSeqNext( txSeqUnmute, txSeqSettings.bTestRXMute ? 0 : txSeqSettings.unmuteDelay );
+                    }
+                    else if( txSeqState == txSeqTXClock )
+                    {
+                        // The PA is waiting to go on so switch the clocks
+                        // back first and then wait the TX delay
+                        ioStopSequenceTimer();
+                        txSeqNext( txSeqMute, 0 );
+                    }
+                    else
+                    {
+                        // Only possible with very short delays - the PA
+                        // is already back on so restore the TX clock now
+                        bKeyedAgain = true;
+                    }
+                }
+
+                if( bKeyedAgain )
+                {
+                    setTXRXClocks( true );
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+}
+
+// Handle key up and down - mute RX, transmit, sidetone etc.
+// The sequencer takes care of the timing so this returns straight away.
+// May be called from an interrupt.
+void txSeqKeyDown( bool bDown )
+{
+    // Time from key down to the PA going on
+    uint16_t paDelay = txSeqSettings.muteDelay + ((txSeqSettings.bBreakIn && txSeqSettings.bTXClockEnabled) ? txSeqSettings.txDelay : 0);
+
+    bKeyIsDown = bDown;
+
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE )
+    {
+        if( bKeyIsDown )
+        {
+            // Time how long it takes for the PA to go on
+            if( txSeqState != txSeqTX )
+            {
+                uint16_t paddleTimestamp;
+
+                keyDownTimestamp = ioReadTimestamp();
+                bTimingKeyDown = true;
+
+                // Also time from the paddle being pressed
+                if( ioReadPaddleTimestamp( &paddleTimestamp ) )
+                {
+                    latencyRecord( latencyPaddle, keyDownTimestamp - paddleTimestamp );
+                }
+            }
+
+            switch( txSeqState )
+            {
+                case txSeqRX:
+                    if( !txSeqSettings.bTestRXMute )
+                    {
+                        // Mute RX first
+                        txSeqMuteRX( true );
+                    }
+                    txSeqNext( txSeqMute, txSeqSettings.bTestRXMute ? 0 : txSeqSettings.muteDelay );
+                    break;
+
+                case txSeqKeyUp:
+                {
+                    // The PA is still on from the last element. Once it goes
+                    // off it must come on again paDelay after now.
+                    uint16_t paOffTime = ioReadSequenceTimer();
+                    txSeqGap = (paDelay > paOffTime) ? (paDelay - paOffTime) : 0;
+                    break;
+                }
+
+                case txSeqHang:
+                case txSeqPAOff:
+                    // Still set up for TX so only need to turn the PA back on
+                    bTXSeqClocksDue = false;
+                    txSeqNext( txSeqTXClock, paDelay );
+                    break;
+
+                case txSeqUnmute:
+                    // Still muted so go straight to swapping the clocks
+                    txSeqNext( txSeqMute, txSeqSettings.bTestRXMute ? 0 : txSeqSettings.muteDelay );
+                    break;
+
+                default:
+                    break;
+            }
+        }
+        else if( txSeqState == txSeqTX )
+        {
+            uint16_t paddleTimestamp;
+
+            // Delay the same as before key down so that the dot or dash
+            // is not truncated
+            txSeqNext( txSeqKeyUp, txSeqSettings.muteDelay + (txSeqSettings.bBreakIn ? txSeqSettings.txDelay : 0) );
+
+            // A paddle pressed during the element is keyer memory
+            // rather than latency so don't time it
+            ioReadPaddleTimestamp( &paddleTimestamp );
+        }
+    }
+}
+
+// True while transmitting
+bool txSeqTransmitting()
+{
+    return bTransmitting;
+}
+
+// True from key down until back to receiving
+bool txSeqKeying()
+{
+    return txSeqState != txSeqRX;
+}
@@ -0,0 +1,65 @@
+/*
+ * sequencer.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <inttypes.h>
+
+// Settings for switching between RX and TX - changed by the menus
+struct sTXSeqSettings
+{
+    // Delays before muting, before unmuting and before the PA goes on (us)
+    uint16_t muteDelay;
+    uint16_t unmuteDelay;
+    uint16_t txDelay;
+
+    // Set to true if break in is enabled
+    bool bBreakIn;
+
+    // Set to true for semi break in i.e. stay in TX between elements
+    // until the key has been up for the hang time (ms)
+    bool bSemiBreakIn;
+    uint16_t hangTime;
+
+    // Set to true when testing RX mute function
+    bool bTestRXMute;
+
+    // Set to true when the RX clock, TX clock, morse output and
+    // sidetone are enabled
+    bool bRXClockEnabled;
+    bool bTXClockEnabled;
+    bool bTXOutEnabled;
+    bool bSidetone;
+};
+
+extern struct sTXSeqSettings txSeqSettings;
+
+// Handle key up and down - mute RX, transmit, sidetone etc.
+// The sequencer takes care of the timing so this returns straight away.
+// May be called from an interrupt.
+void txSeqKeyDown( bool bDown );
+
+// Called from the main loop to take the steps of the TX/RX sequence that
+// switch the clocks over I2C.
+void txSequencer();
+
+// Called from the sequence timer interrupt when the current step of
+// switching between RX and TX is due
+void txSequencerTimer();
+
+// Mute or unmute the RX
+void txSeqMuteRX( bool bMute );
+
+// True while transmitting
+bool txSeqTransmitting();
+
+// True from key down until back to receiving
+bool txSeqKeying();
+
+#endif //SEQUENCER_H
@@ -0,0 +1,568 @@
+/*
+ * synth.c
+ *
+ * Register level access to the Si5351 for retuning a PLL without going
+ * through the oscillator library. The library sets the clocks up -
+ * PLL source, multisynth dividers, phase offsets and PLL reset - and
+ * this only changes the PLL feedback divider of clocks that are on an
+ * integer multisynth divider. That is all that has to change while
+ * tuning across a band and it needs no PLL reset.
+ *
+ * For FSK the numerator for every tone is worked out to a fraction of
+ * a Hz before the transmission so that each symbol only writes the
+ * registers holding it.
+ *
+ * Nothing is assumed about how the library has set the chip up. The
+ * clock control and multisynth registers are read back and the PLL is
+ * only written directly if they show it is safe to do so.
+ *
+ * A shadow copy is kept of the registers read and written here so
+ * that a write only sends the registers that have changed, as one
+ * transfer from the first changed register to the last. The shadow is
+ * forgotten whenever the library writes to the chip.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "config.h"
+#include "io.h"
+#include "synth.h"
+
+// Si5351 registers
+#define SYNTH_OUTPUT_ENABLE  3      // Output disable - bit n set turns off clock n
+#define SYNTH_CLK_CONTROL   16      // Clock control - one per clock
+#define SYNTH_PLLA_PARAMS   26      // PLL A feedback divider parameters
+#define SYNTH_PLLB_PARAMS   34      // PLL B feedback divider parameters
+#define SYNTH_MS_PARAMS     42      // Multisynth 0 parameters, then 1 and 2
+#define SYNTH_PLL_RESET    177      // PLL soft reset
+#define SYNTH_PARAM_REGS     8      // Parameter registers for each divider
+
+// Clock control register bits
+#define SYNTH_CLK_PDN       0x80    // Powered down
+#define SYNTH_MS_INT        0x40    // Multisynth in integer mode
+#define SYNTH_MS_SRC        0x20    // Multisynth fed from PLL B
+#define SYNTH_CLK_IDRV      0x03    // Output drive strength
+
+// PLL reset register bits
+#define SYNTH_PLLA_RST      0x20
+#define SYNTH_PLLB_RST      0x80
+
+// Even integer multisynth divider range
+#define SYNTH_MIN_MS_DIV    6
+#define SYNTH_MAX_MS_DIV    2048
+
+// R divider and divide by 4 bits in the third multisynth parameter register
+#define SYNTH_R_DIV_MASK    0x7C
+
+// PLL fraction denominator - the largest possible
+#define SYNTH_PLL_DENOM     1048575UL
+
+// The VCO range
+#define SYNTH_MIN_VCO       600000000UL
+#define SYNTH_MAX_VCO       900000000UL
+
+// Registers kept in the shadow copy - from 0 to the last multisynth
+#define SYNTH_SHADOW_REGS   (SYNTH_MS_PARAMS + NUM_CLOCKS * SYNTH_PARAM_REGS)
+
+// Bytes on the bus for a transfer besides the data - the device
+// address and register number, plus the address again to read
+#define SYNTH_WRITE_OVERHEAD 2
+#define SYNTH_READ_OVERHEAD  3
+
+// Shadow copy of the registers and a bit for each that is known
+static uint8_t shadow[SYNTH_SHADOW_REGS];
+static uint8_t shadowKnown[(SYNTH_SHADOW_REGS + 7) / 8];
+
+// Bytes sent and received on the I2C bus
+static uint32_t byteCount;
+
+// Status of the transfer that failed in the last call, else OK
+static enum eI2CStatus busStatus;
+
+// Drive strength bits for each clock and a bit for each clock that has one
+static uint8_t drive[NUM_CLOCKS];
+static uint8_t driveSet;
+
+// Crystal frequency (Hz)
+static uint32_t xtalFreq;
+
+// Reciprocals of the crystal frequency so that the PLL settings can be
+// worked out for each step without dividing - 2^32 / xtalFreq and
+// 2^32 * SYNTH_PLL_DENOM / xtalFreq, both rounded down
+static uint32_t xtalRecip;
+static uint32_t xtalDenomRecip;
+
+// Goes up by one each time the library writes to the chip so that
+// a group knows when to read its set up again
+static uint8_t generation = 1;
+
+// Set the crystal frequency the PLL settings are worked out from
+// The divisions needed are done here once rather than at each step
+void synthSetXtalFrequency( uint32_t freq )
+{
+    xtalFreq = freq;
+    if( freq > SYNTH_PLL_DENOM )
+    {
+        xtalRecip = (1ULL << 32) / freq;
+        xtalDenomRecip = ((uint64_t)SYNTH_PLL_DENOM << 32) / freq;
+    }
+    else
+    {
+        // Too low to be a crystal - stops the PLL being written
+        xtalFreq = 0;
+    }
+}
+
+// The oscillator driver has written to the chip so any set up that
+// has been read from it must be read again
+void synthInvalidate()
+{
+    generation++;
+    memset( shadowKnown, 0, sizeof( shadowKnown ) );
+}
+
+// Bytes sent and received on the I2C bus - for the stats menu
+uint32_t synthByteCount()
+{
+    return byteCount;
+}
+
+// Clear the byte count - for the stats menu
+void synthResetByteCount()
+{
+    byteCount = 0;
+}
+
+// The status of the transfer that failed in the last call that wrote
+// to or read from the chip, or OK - for the bus trace
+enum eI2CStatus synthBusStatus()
+{
+    return busStatus;
+}
+
+// Mark registers as known or unknown in the shadow
+static void setKnown( uint8_t reg, uint8_t len, bool bKnown )
+{
+    for( ; len ; reg++, len-- )
+    {
+        if( bKnown )
+        {
+            shadowKnown[reg / 8] |= (1 << (reg % 8));
+        }
+        else
+        {
+            shadowKnown[reg / 8] &= ~(1 << (reg % 8));
+        }
+    }
+}
+
+static bool isKnown( uint8_t reg )
+{
+    return (shadowKnown[reg / 8] & (1 << (reg % 8))) != 0;
+}
+
+// Make sure the shadow holds a block of registers
+// If any are not known the whole block is read in one transfer
+static bool readRegs( uint8_t reg, uint8_t len )
+{
+    bool bOK = true;
+
+    for( uint8_t i = 0 ; bOK && (i < len) ; i++ )
+    {
+        if( !isKnown( reg + i ) )
+        {
+            busStatus = ioI2CRead( SI5351A_I2C_ADDRESS, reg, &shadow[reg], len );
+            bOK = (busStatus == i2cStatusOK);
+            byteCount += len + SYNTH_READ_OVERHEAD;
+            setKnown( reg, len, bOK );
+            break;
+        }
+    }
+
+    return bOK;
+}
+
+// Write a block of registers
+// Only the ones that differ from the shadow are sent, in one transfer
+// from the first changed register to the last
+static bool writeRegs( uint8_t reg, const uint8_t *data, uint8_t len )
+{
+    bool bOK = true;
+    uint8_t first = len;
+    uint8_t last = 0;
+
+    for( uint8_t i = 0 ; i < len ; i++ )
+    {
+        if( !isKnown( reg + i ) || (shadow[reg + i] != data[i]) )
+        {
+            if( first == len )
+            {
+                first = i;
+            }
+            last = i;
+        }
+    }
+
+    if( first < len )
+    {
+        uint8_t count = last - first + 1;
+
+        busStatus = ioI2CWrite( SI5351A_I2C_ADDRESS, reg + first, &data[first], count );
+        bOK = (busStatus == i2cStatusOK);
+        byteCount += count + SYNTH_WRITE_OVERHEAD;
+        if( bOK )
+        {
+            memcpy( &shadow[reg + first], &data[first], count );
+        }
+
+        // If it failed we do not know what the chip has now
+        setKnown( reg + first, count, bOK );
+    }
+
+    return bOK;
+}
+
+// Encode the three parameters of a divider into its 8 registers
+// The third register's R divider bits are left at zero
+static void encodeParams( uint8_t *params, uint32_t p1, uint32_t p2, uint32_t p3 )
+{
+    params[0] = p3 >> 8;
+    params[1] = p3;
+    params[2] = (p1 >> 16) & 0x03;
+    params[3] = p1 >> 8;
+    params[4] = p1;
+    params[5] = ((p3 >> 12) & 0xF0) | ((p2 >> 16) & 0x0F);
+    params[6] = p2 >> 8;
+    params[7] = p2;
+}
+
+// Decode the P1 and P2 parameters of a divider from its 8 registers
+static void decodeParams( const uint8_t *params, uint32_t *pP1, uint32_t *pP2 )
+{
+    *pP1 = ((uint32_t)(params[2] & 0x03) << 16) | ((uint16_t)params[3] << 8) | params[4];
+    *pP2 = ((uint32_t)(params[5] & 0x0F) << 16) | ((uint16_t)params[6] << 8) | params[7];
+}
+
+// Work out the PLL parameters for a VCO frequency as a + b/c times
+// the crystal frequency. a and b are estimated with the reciprocals,
+// which can only come out one too low, and then corrected so that
+// they are the same as dividing.
+static void makePLLParams( uint8_t *params, uint32_t vco )
+{
+    uint32_t a = ((uint64_t)vco * xtalRecip) >> 32;
+    uint32_t rem = vco - a * xtalFreq;
+    uint32_t b;
+    uint32_t f;
+
+    if( rem >= xtalFreq )
+    {
+        a++;
+        rem -= xtalFreq;
+    }
+
+    // b = rem * SYNTH_PLL_DENOM / xtalFreq
+    b = ((uint64_t)rem * xtalDenomRecip) >> 32;
+    if( ((uint64_t)rem * SYNTH_PLL_DENOM - (uint64_t)b * xtalFreq) >= xtalFreq )
+    {
+        b++;
+    }
+
+    // f = 128 * b / SYNTH_PLL_DENOM, which is one less than a power of 2
+    f = (128 * b) >> 20;
+    if( (128 * b - SYNTH_PLL_DENOM * f) >= SYNTH_PLL_DENOM )
+    {
+        f++;
+    }
+
+    encodeParams( params, 128 * a + f - 512, 128 * b - SYNTH_PLL_DENOM * f, SYNTH_PLL_DENOM );
+}
+
+// True if a frequency on a divider keeps the VCO in range
+static bool vcoInRange( uint32_t freq, uint16_t div )
+{
+    uint64_t vco = (uint64_t)freq * div;
+
+    return (vco >= SYNTH_MIN_VCO) && (vco <= SYNTH_MAX_VCO);
+}
+
+// Work out the PLL numerator that puts a group on a frequency in mHz
+// This is done before a transmission so it can afford to divide
+bool synthMakeTone( const struct sSynthGroup *pGroup, uint64_t freq, struct sSynthTone *pTone )
+{
+    uint8_t params[SYNTH_PARAM_REGS];
+    uint64_t vco = freq * pGroup->div;
+    uint64_t xtal = (uint64_t)xtalFreq * 1000;
+    bool bOK = (pGroup->pllReg != 0) && (xtalFreq != 0) &&
+               (vco >= (uint64_t)SYNTH_MIN_VCO * 1000) && (vco <= (uint64_t)SYNTH_MAX_VCO * 1000);
+
+    if( bOK )
+    {
+        // VCO is (a + b / SYNTH_PLL_DENOM) times the crystal with b rounded
+        uint32_t a = vco / xtal;
+        uint32_t b = ((vco - a * xtal) * SYNTH_PLL_DENOM + xtal / 2) / xtal;
+
+        if( b == SYNTH_PLL_DENOM )
+        {
+            a++;
+            b = 0;
+        }
+
+        encodeParams( params, 128 * a + (128 * b) / SYNTH_PLL_DENOM - 512,
+                      (128 * b) % SYNTH_PLL_DENOM, SYNTH_PLL_DENOM );
+        memcpy( pTone->regs, &params[SYNTH_PARAM_REGS - SYNTH_TONE_REGS], SYNTH_TONE_REGS );
+    }
+
+    return bOK;
+}
+
+// Retune a group to a tone by writing only the numerator registers
+// that change
+bool synthSetTone( struct sSynthGroup *pGroup, const struct sSynthTone *pTone )
+{
+    bool bOK = (pGroup->pllReg != 0) && (pGroup->generation == generation);
+
+    busStatus = i2cStatusOK;
+
+    if( bOK )
+    {
+        bOK = writeRegs( pGroup->pllReg + SYNTH_PARAM_REGS - SYNTH_TONE_REGS, pTone->regs, SYNTH_TONE_REGS );
+    }
+
+    return bOK;
+}
+
+// Read a group's set up from the chip
+// Returns false if it cannot be retuned by its PLL alone
+static bool readGroup( struct sSynthGroup *pGroup )
+{
+    const uint8_t *control = &shadow[SYNTH_CLK_CONTROL];
+    uint32_t p1, p2;
+    bool bOK;
+    int8_t pllB = -1;
+    uint16_t div = 0;
+
+    pGroup->pllReg = 0;
+    pGroup->generation = generation;
+
+    bOK = readRegs( SYNTH_CLK_CONTROL, NUM_CLOCKS );
+
+    // Each clock in the group must be an integer divider from the same PLL
+    for( uint8_t clock = 0 ; bOK && (clock < NUM_CLOCKS) ; clock++ )
+    {
+        if( pGroup->clocks & (1 << clock) )
+        {
+            uint8_t reg = SYNTH_MS_PARAMS + clock * SYNTH_PARAM_REGS;
+            bool bPLLB = (control[clock] & SYNTH_MS_SRC) != 0;
+
+            bOK = (control[clock] & SYNTH_MS_INT) && ((pllB < 0) || (pllB == bPLLB)) &&
+                  readRegs( reg, SYNTH_PARAM_REGS );
+            pllB = bPLLB;
+
+            if( bOK )
+            {
+                // Integer divide is P1 = 128 * div - 512 with no fraction
+                decodeParams( &shadow[reg], &p1, &p2 );
+                bOK = !(shadow[reg + 2] & SYNTH_R_DIV_MASK) && (p2 == 0) && ((p1 & 0x7F) == 0) &&
+                      ((div == 0) || (div == (p1 + 512) / 128));
+                div = (p1 + 512) / 128;
+            }
+        }
+    }
+
+    // No other clock that is running may share the PLL
+    for( uint8_t clock = 0 ; bOK && (clock < NUM_CLOCKS) ; clock++ )
+    {
+        if( !(pGroup->clocks & (1 << clock)) && !(control[clock] & SYNTH_CLK_PDN) )
+        {
+            bOK = (pllB != ((control[clock] & SYNTH_MS_SRC) != 0));
+        }
+    }
+
+    if( bOK && (pllB >= 0) )
+    {
+        pGroup->pllReg = pllB ? SYNTH_PLLB_PARAMS : SYNTH_PLLA_PARAMS;
+        pGroup->div = div;
+    }
+
+    return pGroup->pllReg != 0;
+}
+
+// Retune a group of clocks to a frequency by writing their PLL's
+// feedback divider - only the registers that change are sent
+bool synthRetune( struct sSynthGroup *pGroup, uint32_t freq )
+{
+    bool bOK;
+    uint8_t params[SYNTH_PARAM_REGS];
+
+    busStatus = i2cStatusOK;
+
+    if( pGroup->generation != generation )
+    {
+        readGroup( pGroup );
+    }
+
+    bOK = (pGroup->pllReg != 0) && (xtalFreq != 0) && vcoInRange( freq, pGroup->div );
+
+    if( bOK )
+    {
+        makePLLParams( params, freq * pGroup->div );
+        if( !writeRegs( pGroup->pllReg, params, SYNTH_PARAM_REGS ) )
+        {
+            // Check the set up again next time - the PLL registers
+            // are no longer known so they will all be rewritten
+            pGroup->generation = generation - 1;
+            bOK = false;
+        }
+    }
+
+    return bOK;
+}
+
+// Set a group of clocks up on their own PLL and an integer multisynth
+// divider so that synthRetune() can retune them
+bool synthTakeOver( struct sSynthGroup *pGroup, uint16_t div, uint32_t freq )
+{
+    const uint8_t *control = &shadow[SYNTH_CLK_CONTROL];
+    uint8_t params[SYNTH_PARAM_REGS];
+    uint8_t newControl[NUM_CLOCKS];
+    uint8_t reset;
+    int8_t pllB = -1;
+    bool bOK;
+
+    busStatus = i2cStatusOK;
+
+    pGroup->pllReg = 0;
+
+    bOK = (xtalFreq != 0) && !(div & 1) && (div >= SYNTH_MIN_MS_DIV) && (div <= SYNTH_MAX_MS_DIV) &&
+          vcoInRange( freq, div ) && readRegs( SYNTH_CLK_CONTROL, NUM_CLOCKS );
+
+    // Use the PLL the group is on now if no other clock that is
+    // running is on it, else the other one
+    for( uint8_t clock = 0 ; bOK && (pllB < 0) && (clock < NUM_CLOCKS) ; clock++ )
+    {
+        if( pGroup->clocks & (1 << clock) )
+        {
+            pllB = (control[clock] & SYNTH_MS_SRC) != 0;
+        }
+    }
+
+    for( uint8_t tries = 0 ; bOK && (tries < 2) ; tries++ )
+    {
+        bool bShared = false;
+
+        for( uint8_t clock = 0 ; clock < NUM_CLOCKS ; clock++ )
+        {
+            if( !(pGroup->clocks & (1 << clock)) && !(control[clock] & SYNTH_CLK_PDN) &&
+                (pllB == ((control[clock] & SYNTH_MS_SRC) != 0)) )
+            {
+                bShared = true;
+            }
+        }
+
+        if( !bShared )
+        {
+            break;
+        }
+
+        pllB = !pllB;
+        bOK = (tries == 0);
+    }
+
+    if( bOK )
+    {
+        // The multisynths first so the clocks never run from the new
+        // PLL frequency on the old divider
+        encodeParams( params, 128 * div - 512, 0, 1 );
+        for( uint8_t clock = 0 ; bOK && (clock < NUM_CLOCKS) ; clock++ )
+        {
+            newControl[clock] = control[clock];
+            if( pGroup->clocks & (1 << clock) )
+            {
+                bOK = writeRegs( SYNTH_MS_PARAMS + clock * SYNTH_PARAM_REGS, params, SYNTH_PARAM_REGS );
+                newControl[clock] = (control[clock] & ~SYNTH_MS_SRC) | SYNTH_MS_INT | (pllB ? SYNTH_MS_SRC : 0);
+            }
+        }
+
+        bOK = bOK && writeRegs( SYNTH_CLK_CONTROL, newControl, NUM_CLOCKS );
+    }
+
+    if( bOK )
+    {
+        pGroup->pllReg = pllB ? SYNTH_PLLB_PARAMS : SYNTH_PLLA_PARAMS;
+        pGroup->div = div;
+        makePLLParams( params, freq * div );
+        bOK = writeRegs( pGroup->pllReg, params, SYNTH_PARAM_REGS );
+
+        // The PLL has to be reset once after its source has changed
+        reset = pllB ? SYNTH_PLLB_RST : SYNTH_PLLA_RST;
+        if( bOK )
+        {
+            busStatus = ioI2CWrite( SI5351A_I2C_ADDRESS, SYNTH_PLL_RESET, &reset, 1 );
+            bOK = (busStatus == i2cStatusOK);
+            byteCount += 1 + SYNTH_WRITE_OVERHEAD;
+        }
+    }
+
+    if( bOK )
+    {
+        pGroup->generation = generation;
+    }
+    else
+    {
+        // Part of the set up may have been written so check it again
+        pGroup->pllReg = 0;
+        pGroup->generation = generation - 1;
+    }
+
+    return bOK;
+}
+
+// Set the drive strength of a clock output (2, 4, 6 or 8 mA)
+// It is written by the next synthSetOutputs()
+void synthSetDrive( uint8_t clock, uint8_t mA )
+{
+    drive[clock] = (mA / 2 - 1) & SYNTH_CLK_IDRV;
+    driveSet |= (1 << clock);
+}
+
+// Turn the clock outputs on or off and power the multisynths of the
+// ones not needed down. Outputs are turned off before their multisynth
+// is powered down and turned on after it is powered up.
+bool synthSetOutputs( uint8_t outputs, uint8_t powered )
+{
+    const uint8_t *control = &shadow[SYNTH_CLK_CONTROL];
+    uint8_t mask = (1 << NUM_CLOCKS) - 1;
+    uint8_t newControl[NUM_CLOCKS];
+    uint8_t disable;
+    bool bOK;
+
+    busStatus = i2cStatusOK;
+    bOK = readRegs( SYNTH_OUTPUT_ENABLE, 1 ) && readRegs( SYNTH_CLK_CONTROL, NUM_CLOCKS );
+
+    for( uint8_t clock = 0 ; clock < NUM_CLOCKS ; clock++ )
+    {
+        newControl[clock] = control[clock] & ~SYNTH_CLK_PDN;
+        if( !(powered & (1 << clock)) )
+        {
+            newControl[clock] |= SYNTH_CLK_PDN;
+        }
+        if( driveSet & (1 << clock) )
+        {
+            newControl[clock] = (newControl[clock] & ~SYNTH_CLK_IDRV) | drive[clock];
+        }
+    }
+
+    // Turn off the outputs going off, power up and down, then turn on
+    // the outputs coming on. Writes that change nothing are skipped.
+    disable = shadow[SYNTH_OUTPUT_ENABLE] | (~outputs & mask);
+    bOK = bOK && writeRegs( SYNTH_OUTPUT_ENABLE, &disable, 1 );
+    bOK = bOK && writeRegs( SYNTH_CLK_CONTROL, newControl, NUM_CLOCKS );
+    disable = (disable & ~mask) | (~outputs & mask);
+    bOK = bOK && writeRegs( SYNTH_OUTPUT_ENABLE, &disable, 1 );
+
+    return bOK;
+}
@@ -0,0 +1,99 @@
+/*
+ * synth.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <inttypes.h>
+
+#include "io.h"
+
+// Clocks that share a PLL and are retuned together by changing only
+// the PLL's feedback divider
+struct sSynthGroup
+{
+    uint8_t  clocks;        // Bit n set for clock n
+    uint8_t  generation;    // Set up read when the chip was at this generation
+    uint8_t  pllReg;        // First parameter register of their PLL, 0 if unknown
+    uint16_t div;           // Their integer multisynth divider
+};
+
+// PLL feedback divider numerator for one tone - the registers holding
+// P1 and P2. All tones share the same denominator so a tone only has
+// to write these.
+#define SYNTH_TONE_REGS 6
+
+struct sSynthTone
+{
+    uint8_t regs[SYNTH_TONE_REGS];
+};
+
+// Set the crystal frequency the PLL settings are worked out from
+void synthSetXtalFrequency( uint32_t freq );
+
+// The oscillator driver has written to the chip so any set up that
+// has been read from it must be read again
+void synthInvalidate();
+
+// Retune a group of clocks to a frequency by writing their PLL's
+// feedback divider. Only the registers that change are sent, in one
+// transfer. The PLL is not reset so the clocks keep their phase
+// relationship.
+// The first time, and after synthInvalidate(), the group's set up is
+// read back from the chip. Every clock in it must be on an integer
+// multisynth divider with no R divider from the same PLL and no other
+// clock that is powered up may use that PLL.
+// Returns false if the group is not set up that way, the VCO would be
+// out of range or the transfer failed, in which case the oscillator
+// driver must be used.
+bool synthRetune( struct sSynthGroup *pGroup, uint32_t freq );
+
+// Take a group of clocks over from the oscillator driver so that they
+// can be retuned with synthRetune(). Each clock is put on the integer
+// multisynth divider div, fed from a PLL that no other running clock
+// uses, and the PLL is set for freq and reset. Nothing is changed if
+// there is no such PLL or freq cannot be reached with div.
+// Returns false if the group could not be taken over.
+bool synthTakeOver( struct sSynthGroup *pGroup, uint16_t div, uint32_t freq );
+
+// Work out the PLL numerator that puts a group on a frequency given in
+// mHz. The group must have been retuned or taken over so that its
+// divider is known.
+// Returns false if it has not or the VCO would be out of range.
+bool synthMakeTone( const struct sSynthGroup *pGroup, uint64_t freq, struct sSynthTone *pTone );
+
+// Retune a group to a tone made by synthMakeTone() by writing only the
+// PLL numerator registers that change
+// Returns false if the oscillator driver has written to the chip since
+// the group was set up or the transfer failed. The group must then be
+// retuned or taken over again before its tones can be used.
+bool synthSetTone( struct sSynthGroup *pGroup, const struct sSynthTone *pTone );
+
+// Set the drive strength of a clock output (2, 4, 6 or 8 mA)
+// It is written by the next synthSetOutputs()
+void synthSetDrive( uint8_t clock, uint8_t mA );
+
+// Turn the clock outputs on or off and power their multisynths up or
+// down. Bit n of outputs set turns clock n on and bit n of powered set
+// powers its multisynth up. An output is turned off before it is
+// powered down and turned on after it is powered up. Only registers
+// that change are written.
+// Returns false if a transfer failed.
+bool synthSetOutputs( uint8_t outputs, uint8_t powered );
+
+// Bytes sent and received on the I2C bus - for the stats menu
+uint32_t synthByteCount();
+
+// Clear the byte count - for the stats menu
+void synthResetByteCount();
+
+// The status of the transfer that failed in the last call that wrote
+// to or read from the chip, or OK - for the bus trace
+enum eI2CStatus synthBusStatus();
+
+#endif //SYNTH_H
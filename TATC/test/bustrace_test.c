@@ -0,0 +1,86 @@
+/*
+ * bustrace_test.c
+ *
+ * Checks the bus trace. The ring must keep the newest BUS_TRACE_LEN
+ * operations, newest first, with the status of each. The totals must
+ * count each error and add up per device.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+
+#include "config.h"
+#include "bustrace.h"
+#include "io.h"
+
+// Simulated RTC
+static uint16_t timestamp;
+
+static int failures;
+
+uint16_t ioReadTimestamp()
+{
+    return timestamp;
+}
+
+static void check( bool bPassed, const char *what )
+{
+    if( !bPassed )
+    {
+        printf( "FAIL %s\n", what );
+        failures++;
+    }
+}
+
+// Record an operation that takes a number of ticks
+static void traceOp( enum eBusOp op, uint16_t ticks, enum eI2CStatus status )
+{
+    BUS_TRACE_START( start );
+    timestamp += ticks;
+    BUS_TRACE_END( op, start, status );
+}
+
+int main()
+{
+    struct sBusTraceEntry entry;
+    struct sBusCounts counts;
+
+    busTraceReset();
+    check( !busTraceRead( 0, &entry ), "empty trace" );
+
+    // More operations than the ring holds, the duration of each being
+    // its number
+    timestamp = 65000;
+    for( uint8_t i = 1 ; i <= BUS_TRACE_LEN + 3 ; i++ )
+    {
+        traceOp( (i & 1) ? busOpTune : busOpDisplay, i, (i == BUS_TRACE_LEN + 3) ? i2cStatusNak : i2cStatusOK );
+    }
+
+    check( busTraceRead( 0, &entry ) && (entry.duration == BUS_TRACE_LEN + 3) &&
+           (entry.status == i2cStatusNak) && (entry.address == SI5351A_I2C_ADDRESS), "newest entry" );
+    check( busTraceRead( 1, &entry ) && (entry.duration == BUS_TRACE_LEN + 2) &&
+           (entry.status == i2cStatusOK) && (entry.address == LCD_I2C_ADDRESS), "second entry" );
+    check( busTraceRead( BUS_TRACE_LEN - 1, &entry ) && (entry.duration == 4), "oldest entry kept" );
+    check( !busTraceRead( BUS_TRACE_LEN, &entry ), "older entries dropped" );
+
+    // Errors are counted by status and added up for the device
+    traceOp( busOpClocks, 10, i2cStatusArbLost );
+    traceOp( busOpBacklight, 10, i2cStatusBusError );
+    busTraceOpCounts( busOpTune, &counts );
+    check( (counts.count == (BUS_TRACE_LEN + 4) / 2) && (counts.failures == 1) && (counts.errors[i2cStatusNak] == 1), "tune counts" );
+    busTraceDeviceCounts( SI5351A_I2C_ADDRESS, &counts );
+    check( (counts.count == (BUS_TRACE_LEN + 6) / 2) && (counts.failures == 2) &&
+           (counts.errors[i2cStatusNak] == 1) && (counts.errors[i2cStatusArbLost] == 1), "oscillator counts" );
+    busTraceDeviceCounts( LCD_I2C_ADDRESS, &counts );
+    check( (counts.failures == 1) && (counts.errors[i2cStatusBusError] == 1) && (counts.errors[i2cStatusNak] == 0), "LCD counts" );
+
+    busTraceReset();
+    busTraceDeviceCounts( SI5351A_I2C_ADDRESS, &counts );
+    check( !busTraceRead( 0, &entry ) && (counts.count == 0), "reset" );
+
+    printf( "bustrace_test: %s\n", failures ? "FAILED" : "passed" );
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * command_test.c
+ *
+ * Sends commands to the serial port command handler and checks the
+ * replies and what it asked the rest of the firmware to do.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "command.h"
+#include "fsk.h"
+#include "message.h"
+#include "serial.h"
+#include "wspr.h"
+
+// Bytes from the host waiting to be read and the replies sent back
+static char rxData[COMMAND_LEN * 2];
+static int rxLen, rxPos;
+static char txData[COMMAND_LEN * 2];
+static int txLen;
+
+// Simulated message memories - the one being sent or -1
+static int sending = -1;
+
+// Simulated FSK transmitter
+static char symbols[FSK_MAX_SYMBOLS + 1];
+static int numSymbols;
+static uint16_t toneOffset;
+static uint32_t toneSpacing;
+static uint16_t symbolLength;
+static bool bFskSending;
+
+// Time given to the WSPR beacon or -1
+static int32_t wsprTime = -1;
+
+static int failures;
+
+bool serialReceive( uint8_t *pData )
+{
+    if( rxPos < rxLen )
+    {
+        *pData = rxData[rxPos++];
+        return true;
+    }
+    return false;
+}
+
+void serialTransmit( uint8_t data )
+{
+    if( txLen < sizeof( txData ) - 1 )
+    {
+        txData[txLen++] = data;
+        txData[txLen] = '\0';
+    }
+}
+
+void messageSend( uint8_t message )
+{
+    sending = message;
+}
+
+void messageStop()
+{
+    sending = -1;
+}
+
+void fskClear()
+{
+    numSymbols = 0;
+    symbols[0] = '\0';
+}
+
+bool fskAddSymbol( uint8_t tone )
+{
+    if( bFskSending || (numSymbols >= FSK_MAX_SYMBOLS) || (tone >= FSK_MAX_TONES) )
+    {
+        return false;
+    }
+    symbols[numSymbols++] = "0123456789ABCDEF"[tone];
+    symbols[numSymbols] = '\0';
+    return true;
+}
+
+void fskSetTones( uint16_t offset, uint32_t spacing )
+{
+    toneOffset = offset;
+    toneSpacing = spacing;
+}
+
+bool fskSetSymbolLength( uint16_t samples )
+{
+    if( samples == 0 )
+    {
+        return false;
+    }
+    symbolLength = samples;
+    return true;
+}
+
+bool fskStart()
+{
+    bFskSending = (numSymbols > 0);
+    return bFskSending;
+}
+
+void fskStop()
+{
+    bFskSending = false;
+}
+
+bool fskSending()
+{
+    return bFskSending;
+}
+
+void wsprSetTime( uint32_t seconds )
+{
+    wsprTime = seconds;
+}
+
+// Send text from the host, run the handler and collect the replies
+static void host( const char *text )
+{
+    strcpy( rxData, text );
+    rxLen = strlen( text );
+    rxPos = 0;
+    txLen = 0;
+    txData[0] = '\0';
+    commandControl();
+}
+
+// Check the replies from the last step
+static void expectReply( const char *step, const char *reply )
+{
+    if( strcmp( txData, reply ) )
+    {
+        printf( "%s: expected reply \"%s\", got \"%s\"\n", step, reply, txData );
+        failures++;
+    }
+}
+
+static void expectSending( const char *step, int expected )
+{
+    if( sending != expected )
+    {
+        printf( "%s: expected message %d, got %d\n", step, expected, sending );
+        failures++;
+    }
+}
+
+int main()
+{
+    char text[COMMAND_LEN + 8];
+
+    // Send each memory and stop
+    host( "MS1;" );
+    expectReply( "send 1", "MS1;" );
+    expectSending( "send 1", 0 );
+    host( "ms4;" );
+    expectReply( "send 4 lower case", "MS4;" );
+    expectSending( "send 4 lower case", 3 );
+    host( "MS0;\r\n" );
+    expectReply( "stop", "MS0;" );
+    expectSending( "stop", -1 );
+
+    // A command split across calls is put back together
+    host( "M" );
+    expectReply( "part command", "" );
+    host( "S2;" );
+    expectReply( "rest of command", "MS2;" );
+    expectSending( "rest of command", 1 );
+    messageStop();
+
+    // Bad commands and parameters
+    host( "MS5;" );
+    expectReply( "no memory 5", "?;" );
+    host( "MS;" );
+    expectReply( "no memory", "?;" );
+    host( "MS1X;" );
+    expectReply( "not a number", "?;" );
+    host( "XX1;" );
+    expectReply( "unknown", "?;" );
+    host( ";" );
+    expectReply( "empty", "?;" );
+    expectSending( "bad commands", -1 );
+
+    // Too long is refused and the next command is still understood
+    memset( text, '1', sizeof( text ) );
+    memcpy( text, "MS", 2 );
+    strcpy( &text[COMMAND_LEN + 4], ";" );
+    host( text );
+    expectReply( "too long", "?;" );
+    host( "MS3;" );
+    expectReply( "after too long", "MS3;" );
+    expectSending( "after too long", 2 );
+
+    // Load and send FSK symbols
+    host( "FC;" );
+    expectReply( "fsk clear", "FC;" );
+    host( "FG;" );
+    expectReply( "fsk nothing to send", "?;" );
+    host( "FA0123;FA9afF;" );
+    expectReply( "fsk add", "FA0123;FA9AFF;" );
+    host( "FAG;" );
+    expectReply( "fsk bad tone", "?;" );
+    if( strcmp( symbols, "01239AFF" ) )
+    {
+        printf( "fsk add: expected symbols 01239AFF, got %s\n", symbols );
+        failures++;
+    }
+    host( "FT1500,1465;FL8192;" );
+    expectReply( "fsk tones and length", "FT1500,1465;FL8192;" );
+    if( (toneOffset != 1500) || (toneSpacing != 1465) || (symbolLength != 8192) )
+    {
+        printf( "fsk tones and length: got %u, %u, %u\n", toneOffset, toneSpacing, symbolLength );
+        failures++;
+    }
+    host( "FT1500;FT,1465;FT70000,1;FL0;FL70000;" );
+    expectReply( "fsk bad tones and length", "?;?;?;?;?;" );
+    host( "FG;" );
+    expectReply( "fsk go", "FG;" );
+    host( "FC;FA0;FT1500,1465;" );
+    expectReply( "fsk change while sending", "?;?;?;" );
+    host( "FX;" );
+    expectReply( "fsk stop", "FX;" );
+    if( bFskSending || (numSymbols != 8) )
+    {
+        printf( "fsk stop: still sending or symbols changed\n" );
+        failures++;
+    }
+
+    // Set the time for the WSPR beacon
+    host( "TI123456;" );
+    expectReply( "time", "TI123456;" );
+    if( wsprTime != 12 * 3600 + 34 * 60 + 56 )
+    {
+        printf( "time: got %d seconds\n", wsprTime );
+        failures++;
+    }
+    wsprTime = -1;
+    host( "TI240000;TI126000;TI123460;TI12345;TI1234567;TI12:34:;" );
+    expectReply( "bad times", "?;?;?;?;?;?;" );
+    if( wsprTime != -1 )
+    {
+        printf( "bad times: time set to %d\n", wsprTime );
+        failures++;
+    }
+
+    if( failures )
+    {
+        printf( "command_test: %d failures\n", failures );
+        return 1;
+    }
+
+    printf( "command_test: passed\n" );
+    return 0;
+}
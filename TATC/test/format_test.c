@@ -0,0 +1,99 @@
+/*
+ * format_test.c
+ *
+ * Checks the display formatter against sprintf for the formats it
+ * replaces over a spread of values including the edge cases.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "format.h"
+
+static int failures;
+
+static void check( const char *got, const char *expected )
+{
+    if( strcmp( got, expected ) )
+    {
+        printf( "FAIL got \"%s\" expected \"%s\"\n", got, expected );
+        failures++;
+    }
+}
+
+// Test values - powers of ten and either side of them and some others
+#define NUM_VALUES 64
+static uint32_t values[NUM_VALUES];
+static int numValues;
+
+static void addValue( uint32_t value )
+{
+    if( numValues < NUM_VALUES )
+    {
+        values[numValues++] = value;
+    }
+}
+
+int main()
+{
+    char buf[64], expected[64];
+    uint32_t power = 1;
+
+    for( int i = 0 ; i < 10 ; i++ )
+    {
+        addValue( power - 1 );
+        addValue( power );
+        addValue( power + 1 );
+        addValue( power * 9 );
+        power *= 10;
+    }
+    addValue( 7030000 );
+    addValue( 14060000 );
+    addValue( 28999999 );
+    addValue( 123456789 );
+    addValue( UINT32_MAX - 1 );
+    addValue( UINT32_MAX );
+
+    for( int i = 0 ; i < numValues ; i++ )
+    {
+        uint32_t value = values[i];
+
+        // Widths from none to more than the number of digits
+        for( uint8_t width = 0 ; width <= 10 ; width++ )
+        {
+            formatUnsigned( buf, value, width, ' ' );
+            sprintf( expected, "%*lu", width, (unsigned long)value );
+            check( buf, expected );
+
+            formatUnsigned( buf, value, width, '0' );
+            sprintf( expected, "%0*lu", width, (unsigned long)value );
+            check( buf, expected );
+        }
+
+        formatFrequency( buf, value, '.' );
+        sprintf( expected, "%5lu%c%02lu", (unsigned long)(value / 1000), '.', (unsigned long)((value % 1000) / 10) );
+        check( buf, expected );
+
+        formatLabel( buf, "TX dly: ", value, "us" );
+        sprintf( expected, "TX dly: %luus", (unsigned long)value );
+        check( buf, expected );
+    }
+
+    // Chained calls build up a line
+    char *p = formatText( buf, "A " );
+    p = formatFrequency( p, 7030000, '*' );
+    p = formatChar( p, ' ' );
+    formatText( p, "RIT" );
+    check( buf, "A  7030*00 RIT" );
+
+    formatText( buf, "" );
+    check( buf, "" );
+
+    printf( "format_test: %d values - %s\n", numValues, failures ? "FAILED" : "passed" );
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,278 @@
+/*
+ * fsk_test.c
+ *
+ * Runs FSK transmissions against a fake timestamp counter. The symbol
+ * timer interrupt is called when the counter reaches the compare value
+ * and the main loop is called after a random delay each time, as if it
+ * were busy with other things. Checks that the tones are sent in order,
+ * that the symbol boundaries follow the measured counter frequency
+ * with no drift however late the main loop is, and that the TX clock
+ * is put back afterwards.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "fsk.h"
+#include "io.h"
+#include "keyer.h"
+#include "latency.h"
+#include "main.h"
+#include "synth.h"
+
+// WSPR like transmission - 4 tones of 1.465Hz and 8192 samples a symbol
+#define TEST_TX_FREQ     14095600UL
+#define TEST_OFFSET          1500
+#define TEST_SPACING         1465
+#define TEST_SYMBOL_LEN      8192
+#define TEST_SYMBOLS          162
+
+// The timestamp counter is measured at this frequency, well away from
+// TIMESTAMP_FREQ, to check the measured frequency is used
+#define TEST_TIMESTAMP_FREQ 30000
+
+// Longest the main loop takes to come round (ticks)
+#define TEST_MAX_LOOP_DELAY  3000
+
+// Fake timestamp counter and symbol timer
+static uint32_t now;
+static bool bTimerRunning;
+static uint16_t timerCompare;
+
+// Tones made by makeTXTone() (mHz) and the tones set with when and how
+// late they were
+static uint64_t tonesMade[FSK_MAX_TONES];
+static int numTonesMade;
+static int tonesSet[TEST_SYMBOLS + 1];
+static uint32_t setTime[TEST_SYMBOLS + 1];
+static uint16_t setLatency[TEST_SYMBOLS + 1];
+static int numSet;
+
+// Set to make setTXTone() fail from this symbol on
+static int failFrom = -1;
+
+// Key down state and TX clock restores
+static bool bKeyDown;
+static bool bTransmitting;
+static int restores;
+
+static int failures;
+
+uint16_t ioReadTimestamp()
+{
+    return now;
+}
+
+uint32_t ioTimestampFreq()
+{
+    return TEST_TIMESTAMP_FREQ;
+}
+
+void ioStartSymbolTimer( uint16_t timestamp )
+{
+    bTimerRunning = true;
+    timerCompare = timestamp;
+}
+
+void ioStopSymbolTimer()
+{
+    bTimerRunning = false;
+}
+
+bool keyerSendingText()
+{
+    return false;
+}
+
+void latencyRecord( enum eLatencyStage stage, uint16_t ticks )
+{
+    if( (stage == latencySymbol) && (numSet > 0) )
+    {
+        setLatency[numSet - 1] = ticks;
+    }
+}
+
+uint32_t getTXFrequency()
+{
+    return TEST_TX_FREQ;
+}
+
+bool makeTXTone( uint64_t freq, struct sSynthTone *pTone )
+{
+    tonesMade[numTonesMade] = freq;
+    pTone->regs[0] = numTonesMade++;
+    return true;
+}
+
+bool setTXTone( const struct sSynthTone *pTone )
+{
+    if( (failFrom >= 0) && (numSet >= failFrom) )
+    {
+        return false;
+    }
+    tonesSet[numSet] = pTone->regs[0];
+    setTime[numSet++] = now;
+    return true;
+}
+
+void restoreTXClock()
+{
+    restores++;
+}
+
+void keyDown( bool bDown )
+{
+    bKeyDown = bDown;
+    if( bDown )
+    {
+        bTransmitting = true;
+    }
+}
+
+bool getTransmitting()
+{
+    return bTransmitting;
+}
+
+static void check( bool bPassed, const char *what )
+{
+    if( !bPassed )
+    {
+        printf( "FAIL %s\n", what );
+        failures++;
+    }
+}
+
+// Run the fake counter, timer interrupt and main loop until the
+// transmission has finished or for a number of ticks
+static void run( uint32_t ticks )
+{
+    uint32_t end = now + ticks;
+    uint32_t nextLoop = now + 1;
+    bool bDone = false;
+
+    while( (now != end) && !bDone )
+    {
+        now++;
+        if( bTimerRunning && ((uint16_t)now == timerCompare) )
+        {
+            fskTimer();
+        }
+        if( !bKeyDown )
+        {
+            // The PA goes off some time after key up
+            bTransmitting = false;
+        }
+        if( now == nextLoop )
+        {
+            // Once finished go round once more to put the TX clock back
+            bDone = !fskSending();
+            fskScan();
+            nextLoop = now + 1 + rand() % TEST_MAX_LOOP_DELAY;
+        }
+    }
+}
+
+// Load the symbols - each is the tone number below 4 of the symbol number
+static void load( int numSymbols )
+{
+    fskClear();
+    fskSetTones( TEST_OFFSET, TEST_SPACING );
+    check( fskSetSymbolLength( TEST_SYMBOL_LEN ), "symbol length" );
+    for( int i = 0 ; i < numSymbols ; i++ )
+    {
+        check( fskAddSymbol( (i * 7 / 3) % 4 ), "add symbol" );
+    }
+    numTonesMade = 0;
+    numSet = 0;
+    restores = 0;
+}
+
+int main()
+{
+    uint32_t start;
+    uint32_t worstDrift = 0;
+    uint16_t worstLatency = 0;
+
+    srand( 1 );
+
+    // Start just before the counter wraps
+    now = 0xFF00;
+    load( TEST_SYMBOLS );
+    check( !fskAddSymbol( FSK_MAX_TONES ), "tone out of range" );
+    start = now;
+    check( fskStart(), "start" );
+    check( bKeyDown, "key down" );
+    check( !fskAddSymbol( 0 ), "add while sending" );
+
+    // Every tone used is made before the first symbol
+    check( numTonesMade == 4, "tones made" );
+    for( int tone = 0 ; tone < numTonesMade ; tone++ )
+    {
+        check( tonesMade[tone] == (uint64_t)(TEST_TX_FREQ + TEST_OFFSET) * 1000 + tone * TEST_SPACING, "tone frequency" );
+    }
+
+    run( UINT32_MAX );
+    check( !fskSending() && !bKeyDown, "finished" );
+    check( numSet == TEST_SYMBOLS, "every symbol sent" );
+
+    for( int i = 0 ; i < numSet ; i++ )
+    {
+        // When the symbol was due is when it was set less how late it was
+        uint32_t due = setTime[i] - setLatency[i];
+        uint32_t expected = start + (uint64_t)i * TEST_SYMBOL_LEN * TEST_TIMESTAMP_FREQ / FSK_SAMPLE_RATE;
+        uint32_t drift = (due > expected) ? (due - expected) : (expected - due);
+
+        check( tonesSet[i] == (i * 7 / 3) % 4, "tone order" );
+        if( drift > worstDrift )
+        {
+            worstDrift = drift;
+        }
+        if( setLatency[i] > worstLatency )
+        {
+            worstLatency = setLatency[i];
+        }
+    }
+    check( worstDrift <= 1, "symbol boundaries drift" );
+    check( worstLatency < TEST_MAX_LOOP_DELAY, "latency recorded" );
+
+    // The TX clock goes back once the PA is off
+    check( restores == 1, "restore after key up" );
+
+    // A tone that cannot be set stops the transmission
+    load( TEST_SYMBOLS );
+    failFrom = 10;
+    check( fskStart(), "start to fail" );
+    run( UINT32_MAX );
+    check( !fskSending() && !bKeyDown && (numSet == 10) && (restores == 1), "stop on failed tone" );
+    failFrom = -1;
+
+    // Nothing is keyed if the first tone cannot be set
+    load( TEST_SYMBOLS );
+    failFrom = 0;
+    check( !fskStart() && !bKeyDown && (restores == 1), "first tone failed" );
+    failFrom = -1;
+
+    // Aborting leaves the key down and restores the TX clock straight away
+    load( TEST_SYMBOLS );
+    check( fskStart(), "start to abort" );
+    run( TEST_SYMBOL_LEN * 5 );
+    fskAbort();
+    check( !fskSending() && bKeyDown && (restores == 1) && !bTimerRunning, "abort" );
+    keyDown( false );
+
+    if( failures )
+    {
+        printf( "fsk_test: %d failures\n", failures );
+        return 1;
+    }
+
+    printf( "fsk_test: %d symbols, worst drift %u ticks, worst latency %u ticks - passed\n",
+            TEST_SYMBOLS, worstDrift, worstLatency );
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * keyer_test.c
+ *
+ * Checks the length of every element and space the keyer sends at each
+ * speed from MIN_MORSE_WPM to MAX_MORSE_WPM in each keyer mode.
+ *
+ * The RTC is simulated one timestamp tick at a time and the keyer
+ * timer interrupt is called when it reaches the compare value. Both
+ * paddles are held so that the keyer sends dots and dashes.
+ *
+ * Also checks that a quick tap of the other paddle during an element,
+ * let go before the element ends, is sent in every keyer mode.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include "config.h"
+#include "io.h"
+#include "keyer.h"
+#include "main.h"
+#include "morse.h"
+
+// Largest error allowed in any element or space (us)
+#define MAX_ERROR_US 100
+
+// How many dot lengths to hold the paddles for
+#define SQUEEZE_DOTS 40
+
+// Convert timestamp ticks to us
+#define TICKS_TO_US(ticks) ((double)(ticks) * 1000000 / TIMESTAMP_FREQ)
+
+// Simulated RTC
+static uint16_t timestamp;
+static bool bTimerOn;
+static uint16_t timerCompare;
+
+// Simulated paddles and the presses latched by the pin change interrupt
+static bool bDot, bDash;
+static bool bDotLatched, bDashLatched;
+
+// Simulated keyer settings
+static uint8_t wpm;
+static enum eMorseKeyerMode keyerMode;
+
+// When the key last changed and which way
+static long lastEdge;
+static bool bLastDown;
+static long ticks;
+
+// Worst error seen at this speed (us) and the number of elements
+static double worstError;
+static int numElements;
+
+// The elements sent as dots and dashes
+static char sent[64];
+
+uint8_t morseGetWpm()
+{
+    return wpm;
+}
+
+void morseSetWpm( uint8_t newWpm )
+{
+    wpm = newWpm;
+}
+
+enum eMorseKeyerMode morseGetKeyerMode()
+{
+    return keyerMode;
+}
+
+bool morseInTuneMode()
+{
+    return false;
+}
+
+bool ioReadDotPaddle()
+{
+    bool bPressed = bDot || bDotLatched;
+    bDotLatched = false;
+    return bPressed;
+}
+
+bool ioReadDashPaddle()
+{
+    bool bPressed = bDash || bDashLatched;
+    bDashLatched = false;
+    return bPressed;
+}
+
+uint16_t ioReadTimestamp()
+{
+    return timestamp;
+}
+
+void ioStartKeyerTimer( uint16_t newCompare )
+{
+    timerCompare = newCompare;
+    bTimerOn = true;
+}
+
+void ioStopKeyerTimer()
+{
+    bTimerOn = false;
+}
+
+// Record the length of the element or space that has just finished
+void keyDownInterrupt( bool bDown )
+{
+    if( lastEdge >= 0 )
+    {
+        double dotUs = 1200000.0 / wpm;
+        double us = TICKS_TO_US( ticks - lastEdge );
+        double error;
+
+        if( bLastDown )
+        {
+            // An element is a dot or a dash
+            double dotError = fabs( us - dotUs );
+            double dashError = fabs( us - 3 * dotUs );
+
+            error = (dotError < dashError) ? dotError : dashError;
+            if( numElements < sizeof(sent) - 1 )
+            {
+                sent[numElements] = (dotError < dashError) ? '.' : '-';
+                sent[numElements + 1] = '\0';
+            }
+            numElements++;
+        }
+        else
+        {
+            // The space between elements is one dot
+            error = fabs( us - dotUs );
+        }
+
+        if( error > worstError )
+        {
+            worstError = error;
+        }
+    }
+
+    lastEdge = ticks;
+    bLastDown = bDown;
+}
+
+// Run the RTC for a number of ticks
+static void run( long numTicks )
+{
+    for( long i = 0 ; i < numTicks ; i++ )
+    {
+        ticks++;
+        timestamp++;
+        if( bTimerOn && (timestamp == timerCompare) )
+        {
+            keyerTimer();
+        }
+    }
+}
+
+// Hold one paddle, tap the other half way through the first element
+// and let both go before the element ends
+// Returns true if both elements are sent
+static bool tapTest( bool bHoldDash )
+{
+    long dotTicks = (long)TIMESTAMP_FREQ * 1200 / 1000 / wpm;
+
+    worstError = 0;
+    numElements = 0;
+    sent[0] = '\0';
+    lastEdge = -1;
+    ticks = 0;
+
+    bDot = !bHoldDash;
+    bDash = bHoldDash;
+    keyerScanPaddles();
+    run( dotTicks / 2 );
+
+    // The pin change interrupt latches the tap
+    if( bHoldDash )
+    {
+        bDotLatched = true;
+    }
+    else
+    {
+        bDashLatched = true;
+    }
+    bDot = bDash = false;
+    run( 10 * dotTicks );
+
+    return !strcmp( sent, bHoldDash ? "-." : ".-" ) && (worstError <= MAX_ERROR_US);
+}
+
+int main()
+{
+    int failures = 0;
+    double worstOverall = 0;
+
+    for( keyerMode = 0 ; keyerMode < MORSE_NUM_KEYER_MODES ; keyerMode++ )
+    {
+        for( wpm = MIN_MORSE_WPM ; wpm <= MAX_MORSE_WPM ; wpm++ )
+        {
+            long dotTicks = (long)TIMESTAMP_FREQ * 1200 / 1000 / wpm;
+
+            worstError = 0;
+            numElements = 0;
+            lastEdge = -1;
+            ticks = 0;
+
+            // Start near the top so that the timestamp wraps
+            timestamp = 60000;
+
+            // Squeeze the paddles and then let go
+            bDot = bDash = true;
+            keyerScanPaddles();
+            run( SQUEEZE_DOTS * dotTicks );
+            bDot = bDash = false;
+            run( 8 * dotTicks );
+
+            if( (numElements < SQUEEZE_DOTS / 4) || (worstError > MAX_ERROR_US) )
+            {
+                printf( "FAIL mode %d %2d wpm: %d elements, worst error %.0fus\n", keyerMode, wpm, numElements, worstError );
+                failures++;
+            }
+
+            if( worstError > worstOverall )
+            {
+                worstOverall = worstError;
+            }
+        }
+    }
+
+    // A tap during an element must not be lost in any mode
+    wpm = 20;
+    for( keyerMode = 0 ; keyerMode < MORSE_NUM_KEYER_MODES ; keyerMode++ )
+    {
+        for( int hold = 0 ; hold < 2 ; hold++ )
+        {
+            if( !tapTest( hold ) )
+            {
+                printf( "FAIL mode %d tap during %s: sent \"%s\"\n", keyerMode, hold ? "dash" : "dot", sent );
+                failures++;
+            }
+        }
+    }
+
+    printf( "keyer_test: %d to %d wpm, worst error %.0fus - %s\n", MIN_MORSE_WPM, MAX_MORSE_WPM, worstOverall, failures ? "FAILED" : "passed" );
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * latency_test.c
+ *
+ * Records some known times and checks the min, max, mean and
+ * histogram read back from the latency statistics. Also checks that
+ * the stages are kept apart, that long times go in the last bucket
+ * and that a reset clears everything.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "latency.h"
+
+// Convert us to timestamp ticks
+#define US_TO_TICKS(us) ((uint16_t)((uint32_t)(us) * TIMESTAMP_FREQ / 1000000UL))
+
+// Width of a histogram bucket in ticks
+#define BUCKET_TICKS US_TO_TICKS(LATENCY_BUCKET_WIDTH)
+
+static int failures;
+
+static void check( bool bPassed, const char *what )
+{
+    if( !bPassed )
+    {
+        printf( "FAIL %s\n", what );
+        failures++;
+    }
+}
+
+int main()
+{
+    struct sLatencyStats stats;
+    uint16_t expected[LATENCY_NUM_BUCKETS] = { 0 };
+
+    latencyReset();
+
+    latencyRecord( latencyPaddle, 100 );
+    expected[100 / BUCKET_TICKS]++;
+    latencyRecord( latencyPaddle, 300 );
+    expected[300 / BUCKET_TICKS]++;
+    latencyRecord( latencyPaddle, 600 );
+    expected[600 / BUCKET_TICKS]++;
+
+    // Much longer than the histogram so goes in the last bucket
+    latencyRecord( latencyPaddle, 0xFFFF );
+    expected[LATENCY_NUM_BUCKETS - 1]++;
+
+    // A zero time must still count as the min
+    latencyRecord( latencyPaddle, 0 );
+    expected[0]++;
+
+    latencyRead( latencyPaddle, &stats );
+    check( stats.count == 5, "count" );
+    check( stats.min == 0, "min" );
+    // 512 ticks is exactly 15625us
+    check( stats.max == 0xFFFFUL * 15625 / 512, "max" );
+    check( stats.mean == (100UL + 300 + 600 + 0xFFFF) / 5 * 15625 / 512, "mean" );
+    check( !memcmp( stats.histogram, expected, sizeof( expected ) ), "histogram" );
+
+    // Each bucket boundary
+    latencyReset();
+    for( uint8_t bucket = 0 ; bucket < LATENCY_NUM_BUCKETS ; bucket++ )
+    {
+        latencyRecord( latencyClocks, bucket * BUCKET_TICKS );
+        latencyRecord( latencyClocks, (bucket + 1) * BUCKET_TICKS - 1 );
+    }
+    latencyRead( latencyClocks, &stats );
+    for( uint8_t bucket = 0 ; bucket < LATENCY_NUM_BUCKETS ; bucket++ )
+    {
+        check( stats.histogram[bucket] == 2, "bucket boundary" );
+    }
+    check( stats.min == 0, "boundary min" );
+
+    // Other stages are untouched and the reset cleared the first
+    latencyRead( latencyPaddle, &stats );
+    check( stats.count == 0 && stats.max == 0 && stats.histogram[0] == 0, "reset" );
+    latencyRead( latencyPA, &stats );
+    check( stats.count == 0, "stages kept apart" );
+
+    // The min is the smallest even if it is not the first
+    latencyRecord( latencyPA, 100 );
+    latencyRecord( latencyPA, 50 );
+    latencyRecord( latencyPA, 200 );
+    latencyRead( latencyPA, &stats );
+    check( stats.min == 50UL * 15625 / 512 && stats.max == 200UL * 15625 / 512, "min and max" );
+
+    // The count stops when full so that the mean stays right
+    latencyReset();
+    for( uint32_t i = 0 ; i < 0x10010 ; i++ )
+    {
+        latencyRecord( latencySymbol, 64 );
+    }
+    latencyRead( latencySymbol, &stats );
+    check( stats.count == 0xFFFF && stats.mean == 64UL * 15625 / 512, "full count" );
+
+    printf( "latency_test: %s\n", failures ? "FAILED" : "passed" );
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * sequencer_test.c
+ *
+ * Steps the TX/RX sequencer through key down and key up with the
+ * sequence timer simulated one us at a time, calling the main loop
+ * part after every us. Checks that each step happens in the right
+ * order after the right delay for full break in, for the key going
+ * down again before the PA has gone off and for semi break in.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "io.h"
+#include "latency.h"
+#include "main.h"
+#include "sequencer.h"
+
+#define MUTE_DELAY    5000
+#define UNMUTE_DELAY  4000
+#define TX_DELAY      3000
+#define HANG_TIME       20      // ms
+
+// Steps of the sequence as seen on the pins and clocks
+enum eEvent
+{
+    evMute,
+    evUnmute,
+    evTXClocks,
+    evRXClocks,
+    evPAOn,
+    evPAOff,
+};
+
+static const char *eventName[] = { "mute", "unmute", "TX clocks", "RX clocks", "PA on", "PA off" };
+
+#define MAX_EVENTS 32
+static struct
+{
+    enum eEvent event;
+    long time;
+} events[MAX_EVENTS];
+static int numEvents;
+
+// Simulated time (us) and sequence timer
+static long now;
+static bool bTimerOn;
+static long timerEnd;
+
+static int failures;
+
+static void logEvent( enum eEvent event )
+{
+    if( numEvents < MAX_EVENTS )
+    {
+        events[numEvents].event = event;
+        events[numEvents].time = now;
+        numEvents++;
+    }
+}
+
+void ioWriteRXEnableLow()
+{
+    logEvent( evMute );
+}
+
+void ioWriteRXEnableHigh()
+{
+    logEvent( evUnmute );
+}
+
+void ioWriteMorseOutputHigh()
+{
+    logEvent( evPAOn );
+}
+
+void ioWriteMorseOutputLow()
+{
+    logEvent( evPAOff );
+}
+
+void ioWriteSidetoneOn()
+{
+}
+
+void ioWriteSidetoneOff()
+{
+}
+
+void ioStartSequenceTimer( uint16_t us )
+{
+    timerEnd = now + us;
+    bTimerOn = true;
+}
+
+void ioStopSequenceTimer()
+{
+    bTimerOn = false;
+}
+
+uint16_t ioReadSequenceTimer()
+{
+    return bTimerOn ? (timerEnd - now) : 0;
+}
+
+uint16_t ioReadTimestamp()
+{
+    return (uint16_t)((uint64_t)now * TIMESTAMP_FREQ / 1000000);
+}
+
+bool ioReadPaddleTimestamp( uint16_t *pTimestamp )
+{
+    return false;
+}
+
+void latencyRecord( enum eLatencyStage stage, uint16_t ticks )
+{
+}
+
+bool setTXRXClocks( bool bTX )
+{
+    logEvent( bTX ? evTXClocks : evRXClocks );
+    return txSeqSettings.bTXClockEnabled;
+}
+
+// Run for a number of us, calling the main loop after each one
+static void run( long us )
+{
+    for( long i = 0 ; i < us ; i++ )
+    {
+        now++;
+        if( bTimerOn && (now >= timerEnd) )
+        {
+            bTimerOn = false;
+            txSequencerTimer();
+        }
+        txSequencer();
+    }
+}
+
+// Check the events seen against the ones expected
+static void check( const char *name, int num, const enum eEvent *expected, const long *times )
+{
+    bool bPassed = (numEvents == num);
+
+    for( int i = 0 ; bPassed && (i < num) ; i++ )
+    {
+        bPassed = (events[i].event == expected[i]) && (events[i].time == times[i]);
+    }
+
+    if( !bPassed )
+    {
+        printf( "FAIL %s:\n", name );
+        for( int i = 0 ; i < numEvents ; i++ )
+        {
+            printf( "  %-9s at %ldus\n", eventName[events[i].event], events[i].time );
+        }
+        failures++;
+    }
+
+    numEvents = 0;
+}
+
+int main()
+{
+    const long paDelay = MUTE_DELAY + TX_DELAY;
+
+    txSeqSettings.muteDelay = MUTE_DELAY;
+    txSeqSettings.unmuteDelay = UNMUTE_DELAY;
+    txSeqSettings.txDelay = TX_DELAY;
+    txSeqSettings.hangTime = HANG_TIME;
+
+    // Full break in - a 50ms element
+    // The PA is on for exactly as long as the key was down
+    {
+        static const enum eEvent expected[] = { evMute, evTXClocks, evPAOn, evPAOff, evRXClocks, evUnmute };
+        const long times[] = { 0, MUTE_DELAY, paDelay, 50000 + paDelay, 50000 + paDelay + TX_DELAY, 50000 + paDelay + TX_DELAY + UNMUTE_DELAY };
+
+        now = 0;
+        txSeqKeyDown( true );
+        run( 50000 );
+        txSeqKeyDown( false );
+        run( 50000 );
+        check( "break in", 6, expected, times );
+    }
+
+    // The key goes down again 2ms after going up, before the PA has
+    // gone off, so the PA goes off and on again 2ms apart and the
+    // clocks are not switched
+    {
+        static const enum eEvent expected[] = { evMute, evTXClocks, evPAOn, evPAOff, evPAOn, evPAOff, evRXClocks, evUnmute };
+        const long times[] = { 0, MUTE_DELAY, paDelay, 10000 + paDelay, 12000 + paDelay, 22000 + paDelay, 22000 + paDelay + TX_DELAY, 22000 + paDelay + TX_DELAY + UNMUTE_DELAY };
+
+        now = 0;
+        txSeqKeyDown( true );
+        run( 10000 );
+        txSeqKeyDown( false );
+        run( 2000 );
+        txSeqKeyDown( true );
+        run( 10000 );
+        txSeqKeyDown( false );
+        run( 50000 );
+        check( "key down again", 8, expected, times );
+    }
+
+    // Semi break in - stays in TX for the hang time after the PA
+    // goes off and a key down within it only turns the PA on again
+    {
+        static const enum eEvent expected[] = { evMute, evTXClocks, evPAOn, evPAOff, evPAOn, evPAOff, evRXClocks, evUnmute };
+        const long hangEnd = 40000 + paDelay + HANG_TIME * 1000;
+
+        // The hang time is measured with the timestamp so may be out by
+        // a tick or two
+        const long times[] = { 0, MUTE_DELAY, paDelay, 10000 + paDelay, 30000 + paDelay, 40000 + paDelay, hangEnd, hangEnd + UNMUTE_DELAY };
+
+        txSeqSettings.bSemiBreakIn = true;
+        now = 0;
+        txSeqKeyDown( true );
+        run( 10000 );
+        txSeqKeyDown( false );
+        run( 20000 );
+        txSeqKeyDown( true );
+        run( 10000 );
+        txSeqKeyDown( false );
+        run( 100000 );
+
+        // Allow a couple of timestamp ticks either way
+        for( int i = 6 ; i < numEvents ; i++ )
+        {
+            if( labs( events[i].time - times[i] ) <= 2 * 1000000 / TIMESTAMP_FREQ )
+            {
+                events[i].time = times[i];
+            }
+        }
+        check( "semi break in", 8, expected, times );
+        txSeqSettings.bSemiBreakIn = false;
+    }
+
+    // Back to receiving at the end of each test
+    if( txSeqKeying() || txSeqTransmitting() )
+    {
+        printf( "FAIL not back to receiving\n" );
+        failures++;
+    }
+
+    printf( "sequencer_test: %s\n", failures ? "FAILED" : "passed" );
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+/*
+ * avr/io.h
+ *
+ * Host stand-in for the avr-libc header. Defining VPORTC selects the
+ * ATtiny 1-series settings in config.h.
+ */ 
+
+#ifndef STUB_AVR_IO_H
+#define STUB_AVR_IO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define VPORTC VPORTC
+
+#endif //STUB_AVR_IO_H
@@ -0,0 +1,12 @@
+/*
+ * millis.h
+ *
+ * Host stand-in for the library header with just what the tests use
+ */ 
+
+#ifndef MILLIS_H
+#define MILLIS_H
+
+uint32_t millis();
+
+#endif //MILLIS_H
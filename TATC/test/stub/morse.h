@@ -0,0 +1,23 @@
+/*
+ * morse.h
+ *
+ * Host stand-in for the library header with just what the tests use
+ */ 
+
+#ifndef MORSE_H
+#define MORSE_H
+
+enum eMorseKeyerMode
+{
+    morseKeyerIambicA,
+    morseKeyerIambicB,
+    morseKeyerUltimatic,
+    MORSE_NUM_KEYER_MODES
+};
+
+uint8_t morseGetWpm();
+void morseSetWpm( uint8_t wpm );
+enum eMorseKeyerMode morseGetKeyerMode();
+bool morseInTuneMode();
+
+#endif //MORSE_H
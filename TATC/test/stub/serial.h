@@ -0,0 +1,13 @@
+/*
+ * serial.h
+ *
+ * Host stand-in for the library header with just what the tests use
+ */ 
+
+#ifndef SERIAL_H
+#define SERIAL_H
+
+bool serialReceive( uint8_t *pData );
+void serialTransmit( uint8_t data );
+
+#endif //SERIAL_H
@@ -0,0 +1,9 @@
+/*
+ * util/atomic.h
+ *
+ * Host stand-in for the avr-libc header - the tests are single threaded
+ */ 
+
+#define ATOMIC_BLOCK(type) for( int _done = 0 ; !_done ; _done = 1 )
+#define ATOMIC_FORCEON
+#define ATOMIC_RESTORESTATE
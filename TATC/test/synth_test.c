@@ -0,0 +1,411 @@
+/*
+ * synth_test.c
+ *
+ * Checks the direct Si5351 register access against a simulated chip.
+ * The PLL settings, worked out without dividing, must be the same as
+ * dividing for every band over the crystal frequency range.
+ * The PLL settings written must give the frequency asked for, only
+ * the registers that change may be sent, the set up must be read back
+ * once and again after the oscillator library has written to the chip,
+ * clocks that cannot be retuned by their PLL alone must be refused and
+ * a failed transfer must not leave the shadow copy wrong. A clock
+ * taken over must end up on an integer divider from a PLL of its own.
+ * The clock outputs must be set with one write, turned off before they
+ * are powered down and powered up before they are turned on.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "io.h"
+#include "synth.h"
+#include "bandplan.h"
+
+#define XTAL_FREQ   25000000UL
+
+// Half a step of the PLL fraction at 7MHz on a divider of 88 (Hz)
+#define TONE_ERROR  ((double)XTAL_FREQ / 1048575 / 88 / 2)
+
+// Registers used
+#define OUTPUT_ENABLE 3
+#define CLK_CONTROL 16
+#define PLLA_PARAMS 26
+#define PLLB_PARAMS 34
+#define MS_PARAMS   42
+#define PLL_RESET   177
+
+#define CLK_PDN     0x80
+#define MS_INT      0x40
+#define MS_SRC      0x20
+
+// Simulated chip
+static uint8_t chip[256];
+
+// Transfers seen since the last check
+static int numReads, numWrites, bytesWritten;
+static uint8_t lastWriteReg, lastWriteLen;
+
+// Log of the register and first value of each write
+#define LOG_LEN 8
+static uint8_t logReg[LOG_LEN], logValue[LOG_LEN];
+
+// Set to make the chip stop acknowledging
+static bool bNak;
+
+static int failures;
+
+enum eI2CStatus ioI2CWrite( uint8_t address, uint8_t reg, const uint8_t *data, uint8_t len )
+{
+    if( bNak || (address != SI5351A_I2C_ADDRESS) )
+    {
+        return i2cStatusNak;
+    }
+
+    memcpy( &chip[reg], data, len );
+    if( numWrites < LOG_LEN )
+    {
+        logReg[numWrites] = reg;
+        logValue[numWrites] = data[0];
+    }
+    numWrites++;
+    bytesWritten += len;
+    lastWriteReg = reg;
+    lastWriteLen = len;
+    return i2cStatusOK;
+}
+
+enum eI2CStatus ioI2CRead( uint8_t address, uint8_t reg, uint8_t *data, uint8_t len )
+{
+    if( bNak || (address != SI5351A_I2C_ADDRESS) )
+    {
+        return i2cStatusNak;
+    }
+
+    memcpy( data, &chip[reg], len );
+    numReads++;
+    return i2cStatusOK;
+}
+
+static void check( bool bPassed, const char *what )
+{
+    if( !bPassed )
+    {
+        printf( "FAIL %s\n", what );
+        failures++;
+    }
+}
+
+static void clearCounts()
+{
+    numReads = numWrites = bytesWritten = 0;
+}
+
+// Set up a multisynth as the library would - integer or with a fraction
+static void setMultisynth( uint8_t clock, uint16_t div, uint32_t p2, uint8_t rDiv )
+{
+    uint8_t *params = &chip[MS_PARAMS + clock * 8];
+    uint32_t p1 = 128 * div - 512;
+
+    memset( params, 0, 8 );
+    params[1] = 1;
+    params[2] = (rDiv << 4) | ((p1 >> 16) & 3);
+    params[3] = p1 >> 8;
+    params[4] = p1;
+    params[5] = (p2 >> 16) & 0x0F;
+    params[6] = p2 >> 8;
+    params[7] = p2;
+}
+
+// The VCO frequency the chip's PLL is set to (Hz)
+static double pllFrequency( uint8_t reg )
+{
+    const uint8_t *params = &chip[reg];
+    uint32_t p1 = ((uint32_t)(params[2] & 3) << 16) | (params[3] << 8) | params[4];
+    uint32_t p2 = ((uint32_t)(params[5] & 0x0F) << 16) | (params[6] << 8) | params[7];
+    uint32_t p3 = ((uint32_t)(params[5] & 0xF0) << 12) | (params[0] << 8) | params[1];
+
+    // Feedback divide is (P1 + 512 + P2 / P3) / 128
+    return (double)XTAL_FREQ * ((double)(p1 + 512) + (double)p2 / p3) / 128;
+}
+
+// True if the PLL gives freq * div to within one step of the fraction
+static bool pllMatches( uint8_t reg, uint32_t freq, uint16_t div )
+{
+    double error = pllFrequency( reg ) - (double)freq * div;
+
+    // One step is XTAL_FREQ / 1048575 Hz
+    return (error > -24.0) && (error < 24.0);
+}
+
+// The PLL registers for a VCO frequency worked out by dividing
+static void referencePLL( uint8_t *params, uint32_t xtal, uint32_t vco )
+{
+    uint32_t denom = 1048575;
+    uint32_t a = vco / xtal;
+    uint32_t b = ((uint64_t)(vco % xtal) * denom) / xtal;
+    uint32_t f = (128 * b) / denom;
+    uint32_t p1 = 128 * a + f - 512;
+    uint32_t p2 = 128 * b - denom * f;
+
+    params[0] = denom >> 8;
+    params[1] = denom;
+    params[2] = (p1 >> 16) & 0x03;
+    params[3] = p1 >> 8;
+    params[4] = p1;
+    params[5] = ((denom >> 12) & 0xF0) | ((p2 >> 16) & 0x0F);
+    params[6] = p2 >> 8;
+    params[7] = p2;
+}
+
+// Put the chip back as the library sets up the RX pair and TX clock
+static void resetChip()
+{
+    memset( chip, 0, sizeof( chip ) );
+
+    // RX pair on PLL A dividing by 100, TX on PLL B
+    chip[CLK_CONTROL + 0] = MS_INT;
+    chip[CLK_CONTROL + 1] = MS_INT;
+    chip[CLK_CONTROL + 2] = MS_INT | MS_SRC;
+    setMultisynth( 0, 100, 0, 0 );
+    setMultisynth( 1, 100, 0, 0 );
+    setMultisynth( 2, 100, 0, 0 );
+
+    synthInvalidate();
+    clearCounts();
+}
+
+int main()
+{
+    struct sSynthTone tones[4];
+    struct sSynthGroup rx = { 0x03 };
+    struct sSynthGroup tx = { 0x04 };
+    uint8_t saved[8];
+
+    synthSetXtalFrequency( XTAL_FREQ );
+
+    // First retune reads the set up and writes the whole PLL
+    resetChip();
+    check( synthRetune( &rx, 7030000 ), "RX retune" );
+    check( pllMatches( PLLA_PARAMS, 7030000, 100 ), "RX PLL frequency" );
+    check( numReads == 3, "RX set up read once" );
+    check( (numWrites == 1) && (lastWriteReg == PLLA_PARAMS) && (lastWriteLen == 8), "whole PLL written" );
+
+    // A small step only sends the registers that change and reads nothing
+    clearCounts();
+    check( synthRetune( &rx, 7030010 ), "RX step" );
+    check( pllMatches( PLLA_PARAMS, 7030010, 100 ), "RX step frequency" );
+    check( (numReads == 0) && (numWrites == 1) && (lastWriteLen < 8) && (lastWriteReg > PLLA_PARAMS), "only the changes written" );
+
+    // The same frequency again writes nothing
+    clearCounts();
+    check( synthRetune( &rx, 7030010 ), "RX same" );
+    check( (numReads == 0) && (numWrites == 0), "nothing written for no change" );
+
+    // Every frequency across the band
+    for( uint32_t freq = 7000000 ; freq <= 7200000 ; freq += 997 )
+    {
+        synthRetune( &rx, freq );
+        if( !pllMatches( PLLA_PARAMS, freq, 100 ) )
+        {
+            printf( "FAIL %u Hz\n", freq );
+            failures++;
+            break;
+        }
+    }
+
+    // The PLL settings worked out without dividing must be the same as
+    // dividing for every band over the whole crystal frequency range
+    for( uint8_t b = 0 ; b < NUM_BANDS ; b++ )
+    {
+        uint32_t lo = band[b].minFreq - BAND_DIVIDER_MARGIN;
+        uint32_t hi = band[b].maxFreq + BAND_DIVIDER_MARGIN;
+        uint32_t step = (hi - lo) / 40;
+        int mismatches = 0;
+
+        resetChip();
+        setMultisynth( 0, band[b].outDiv, 0, 0 );
+        setMultisynth( 1, band[b].outDiv, 0, 0 );
+
+        for( uint32_t xtal = MIN_XTAL_FREQUENCY ; xtal <= MAX_XTAL_FREQUENCY ; xtal += 9973 )
+        {
+            synthSetXtalFrequency( xtal );
+            for( uint32_t freq = lo ; freq <= hi ; freq = (freq < hi && freq + step > hi) ? hi : freq + step )
+            {
+                uint8_t expected[8];
+
+                referencePLL( expected, xtal, freq * band[b].outDiv );
+                if( !synthRetune( &rx, freq ) || memcmp( expected, &chip[PLLA_PARAMS], 8 ) )
+                {
+                    mismatches++;
+                }
+                if( freq == hi )
+                {
+                    break;
+                }
+            }
+        }
+
+        if( mismatches )
+        {
+            printf( "FAIL %s: %d PLL settings differ from dividing\n", band[b].bandName, mismatches );
+            failures++;
+        }
+    }
+    synthSetXtalFrequency( XTAL_FREQ );
+    resetChip();
+
+    // The TX clock is on PLL B on its own
+    clearCounts();
+    check( synthRetune( &tx, 7030000 ), "TX retune" );
+    check( pllMatches( PLLB_PARAMS, 7030000, 100 ), "TX PLL frequency" );
+
+    // After the library has written the set up is read again
+    clearCounts();
+    synthInvalidate();
+    check( synthRetune( &rx, 7030000 ), "RX after library" );
+    check( numReads == 3, "set up read again" );
+
+    // The VCO must stay in range
+    check( !synthRetune( &rx, 10000000 ), "VCO too high refused" );
+    check( !synthRetune( &rx, 5000000 ), "VCO too low refused" );
+
+    // Clocks that cannot be retuned by their PLL alone are refused
+    resetChip();
+    setMultisynth( 1, 100, 5, 0 );
+    synthInvalidate();
+    check( !synthRetune( &rx, 7030000 ), "fractional multisynth refused" );
+
+    resetChip();
+    setMultisynth( 0, 100, 0, 2 );
+    synthInvalidate();
+    check( !synthRetune( &rx, 7030000 ), "R divider refused" );
+
+    resetChip();
+    setMultisynth( 1, 102, 0, 0 );
+    synthInvalidate();
+    check( !synthRetune( &rx, 7030000 ), "different dividers refused" );
+
+    resetChip();
+    chip[CLK_CONTROL + 1] = MS_INT | MS_SRC;
+    synthInvalidate();
+    check( !synthRetune( &rx, 7030000 ), "different PLLs refused" );
+
+    resetChip();
+    chip[CLK_CONTROL + 1] = 0;
+    synthInvalidate();
+    check( !synthRetune( &rx, 7030000 ), "fractional mode refused" );
+
+    // The TX clock on PLL A would be moved by the RX retune
+    resetChip();
+    chip[CLK_CONTROL + 2] = MS_INT;
+    synthInvalidate();
+    check( !synthRetune( &rx, 7030000 ), "shared PLL refused" );
+
+    // Unless it is powered down
+    resetChip();
+    chip[CLK_CONTROL + 2] = MS_INT | CLK_PDN;
+    synthInvalidate();
+    check( synthRetune( &rx, 7030000 ), "powered down clock ignored" );
+
+    // A failed write must not leave the shadow thinking the chip has it
+    resetChip();
+    check( synthRetune( &rx, 7030000 ), "before NAK" );
+    bNak = true;
+    check( !synthRetune( &rx, 7040000 ) && (synthBusStatus() == i2cStatusNak), "NAK reported" );
+    bNak = false;
+    clearCounts();
+    check( synthRetune( &rx, 7040000 ) && (synthBusStatus() == i2cStatusOK), "after NAK" );
+    check( pllMatches( PLLA_PARAMS, 7040000, 100 ) && (numWrites == 1), "rewritten after NAK" );
+
+    // The TX clock is taken over from a fractional divider on the RX
+    // PLL and moved to PLL B
+    resetChip();
+    chip[CLK_CONTROL + 2] = 0;
+    setMultisynth( 2, 100, 12345, 0 );
+    synthRetune( &rx, 7030000 );
+    memcpy( saved, &chip[PLLA_PARAMS], sizeof( saved ) );
+    check( synthTakeOver( &tx, 88, 7030000 ), "TX take over" );
+    check( chip[CLK_CONTROL + 2] == (MS_INT | MS_SRC), "TX on PLL B integer" );
+    check( (chip[MS_PARAMS + 2 * 8 + 4] == ((128 * 88 - 512) & 0xFF)) && (chip[MS_PARAMS + 2 * 8 + 7] == 0), "TX divider" );
+    check( pllMatches( PLLB_PARAMS, 7030000, 88 ) && (chip[PLL_RESET] == 0x80), "TX PLL set and reset" );
+    check( (chip[CLK_CONTROL] == MS_INT) && !memcmp( saved, &chip[PLLA_PARAMS], sizeof( saved ) ), "RX left alone" );
+    clearCounts();
+    check( synthRetune( &tx, 7030050 ) && pllMatches( PLLB_PARAMS, 7030050, 88 ), "TX retune" );
+    check( (numReads == 0) && (numWrites == 1) && (lastWriteReg > PLLB_PARAMS), "TX numerator only" );
+
+    // FSK tones 1.465Hz apart are set to within half a step of the
+    // fraction by writing only the numerator registers that change
+    for( int tone = 0 ; tone < 4 ; tone++ )
+    {
+        check( synthMakeTone( &tx, 7040000000ULL + tone * 1465, &tones[tone] ), "make tone" );
+    }
+    clearCounts();
+    for( int tone = 0 ; tone < 4 ; tone++ )
+    {
+        double error;
+
+        check( synthSetTone( &tx, &tones[tone] ), "set tone" );
+        error = pllFrequency( PLLB_PARAMS ) / 88 - (7040000.0 + tone * 1.465);
+        check( (error > -TONE_ERROR) && (error < TONE_ERROR), "tone frequency" );
+        check( lastWriteReg >= PLLB_PARAMS + 8 - SYNTH_TONE_REGS, "tone numerator only" );
+    }
+    check( (numReads == 0) && (numWrites == 4), "one write a tone" );
+    clearCounts();
+    check( synthSetTone( &tx, &tones[3] ) && (numWrites == 0), "same tone not rewritten" );
+    check( !synthMakeTone( &tx, 12000000000ULL, &tones[0] ), "tone VCO out of range" );
+
+    // Tones cannot be used once the library has written to the chip
+    synthInvalidate();
+    check( !synthSetTone( &tx, &tones[0] ) && (numWrites == 0), "tone refused after library" );
+
+    // Not if both PLLs have running clocks on them
+    resetChip();
+    chip[CLK_CONTROL + 1] = MS_INT | MS_SRC;
+    synthInvalidate();
+    check( !synthTakeOver( &tx, 88, 7030000 ), "no free PLL refused" );
+    check( numWrites == 0, "nothing written when refused" );
+    check( !synthTakeOver( &tx, 87, 7030000 ), "odd divider refused" );
+
+    // The outputs are set with one write and the other bits kept
+    resetChip();
+    chip[OUTPUT_ENABLE] = 0xFF;
+    check( synthSetOutputs( 0x05, 0x07 ) && (chip[OUTPUT_ENABLE] == 0xFA), "outputs set" );
+    check( (numReads == 2) && (numWrites == 1), "outputs one write" );
+    clearCounts();
+    check( synthSetOutputs( 0x01, 0x07 ) && (chip[OUTPUT_ENABLE] == 0xFE), "outputs changed" );
+    check( (numReads == 0) && (numWrites == 1), "outputs from the shadow" );
+    clearCounts();
+    check( synthSetOutputs( 0x01, 0x07 ) && (numWrites == 0), "outputs not rewritten" );
+
+    // Turning the TX clock off turns the output off and then powers it
+    // down with the band's drive strength
+    synthSetDrive( 0, 4 );
+    synthSetDrive( 1, 4 );
+    synthSetDrive( 2, 8 );
+    synthSetOutputs( 0x07, 0x07 );
+    clearCounts();
+    check( synthSetOutputs( 0x03, 0x03 ), "TX off" );
+    check( (numWrites == 2) && (logReg[0] == OUTPUT_ENABLE) && (logValue[0] == 0xFC) &&
+           (logReg[1] == CLK_CONTROL + 2) && (logValue[1] == (MS_INT | MS_SRC | CLK_PDN | 3)), "TX off then powered down" );
+    check( (chip[CLK_CONTROL] == (MS_INT | 1)) && (chip[CLK_CONTROL + 1] == (MS_INT | 1)), "RX drive" );
+
+    // Turning it on powers it up first
+    clearCounts();
+    check( synthSetOutputs( 0x07, 0x07 ), "TX on" );
+    check( (numWrites == 2) && (logReg[0] == CLK_CONTROL + 2) && (logValue[0] == (MS_INT | MS_SRC | 3)) &&
+           (logReg[1] == OUTPUT_ENABLE) && (logValue[1] == 0xF8), "TX powered up then on" );
+
+    // The byte count is the data plus the address and register bytes
+    resetChip();
+    synthResetByteCount();
+    synthRetune( &rx, 7030000 );
+    check( synthByteCount() == (3 + 3) + 2 * (8 + 3) + (8 + 2), "byte count" );
+
+    printf( "synth_test: %s\n", failures ? "FAILED" : "passed" );
+
+    return failures ? 1 : 0;
+}
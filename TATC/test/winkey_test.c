@@ -0,0 +1,224 @@
+/*
+ * winkey_test.c
+ *
+ * Plays the part of a WinKeyer host talking to the emulation over the
+ * serial port. Each step sends some bytes, runs the main loop call
+ * and checks the bytes sent back and the text given to the keyer.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "keyer.h"
+#include "morse.h"
+#include "serial.h"
+#include "winkey.h"
+
+// Bytes from the host waiting to be read and the replies sent back
+static uint8_t rxData[WINKEY_BUFFER_LEN * 2];
+static int rxLen, rxPos;
+static uint8_t txData[WINKEY_BUFFER_LEN];
+static int txLen;
+
+// Simulated keyer
+static char queued[WINKEY_BUFFER_LEN * 2];
+static int numQueued;
+static uint8_t queueSpace;
+static bool bKeyerBusy;
+static uint8_t paddlePresses;
+static uint8_t wpm = DEFAULT_MORSE_WPM;
+
+static int failures;
+
+bool serialReceive( uint8_t *pData )
+{
+    if( rxPos < rxLen )
+    {
+        *pData = rxData[rxPos++];
+        return true;
+    }
+    return false;
+}
+
+void serialTransmit( uint8_t data )
+{
+    if( txLen < sizeof( txData ) )
+    {
+        txData[txLen++] = data;
+    }
+}
+
+bool keyerQueueChar( char c )
+{
+    if( queueSpace == 0 )
+    {
+        return false;
+    }
+    queued[numQueued++] = c;
+    queued[numQueued] = '\0';
+    bKeyerBusy = true;
+    return true;
+}
+
+uint8_t keyerQueueSpace()
+{
+    return queueSpace;
+}
+
+void keyerClearQueue()
+{
+    bKeyerBusy = false;
+}
+
+bool keyerSendingText()
+{
+    return bKeyerBusy;
+}
+
+uint8_t keyerPaddlePresses()
+{
+    return paddlePresses;
+}
+
+uint8_t morseGetWpm()
+{
+    return wpm;
+}
+
+void morseSetWpm( uint8_t newWpm )
+{
+    wpm = newWpm;
+}
+
+// Send bytes from the host, run the emulation and collect the replies
+static void host( const char *data, int len )
+{
+    memcpy( rxData, data, len );
+    rxLen = len;
+    rxPos = 0;
+    txLen = 0;
+    winkeyControl();
+}
+
+// Check the replies from the last step
+static void expectReply( const char *step, const char *reply, int len )
+{
+    if( (txLen != len) || memcmp( txData, reply, len ) )
+    {
+        printf( "%s: expected %d reply bytes, got %d:", step, len, txLen );
+        for( int i = 0 ; i < txLen ; i++ )
+        {
+            printf( " %02X", txData[i] );
+        }
+        printf( "\n" );
+        failures++;
+    }
+}
+
+// Check the text given to the keyer since the last check
+static void expectQueued( const char *step, const char *text )
+{
+    if( strcmp( queued, text ) )
+    {
+        printf( "%s: expected \"%s\" queued, got \"%s\"\n", step, text, queued );
+        failures++;
+    }
+    numQueued = 0;
+    queued[0] = '\0';
+}
+
+static void expectWpm( const char *step, uint8_t expected )
+{
+    if( wpm != expected )
+    {
+        printf( "%s: expected %d wpm, got %d\n", step, expected, wpm );
+        failures++;
+    }
+}
+
+int main()
+{
+    char text[WINKEY_BUFFER_LEN];
+
+    queueSpace = 16;
+
+    // CAT commands are ignored until the host opens the WinKeyer
+    host( "FA;TEST", 7 );
+    expectReply( "before open", "", 0 );
+    expectQueued( "before open", "" );
+
+    // Open gives the version and then the first status
+    host( "\x00\x02", 2 );
+    expectReply( "open", "\x17\xC0", 2 );
+
+    host( "\x00\x04" "A", 3 );
+    expectReply( "echo", "A", 1 );
+
+    host( "\x02\x19", 2 );
+    expectWpm( "set wpm", 25 );
+
+    host( "\x15", 1 );
+    expectReply( "get status", "\xC0", 1 );
+
+    // Text goes to the keyer and busy is reported until it has gone
+    host( "CQ TEST", 7 );
+    expectReply( "text", "\xC4", 1 );
+    expectQueued( "text", "CQ TEST" );
+    bKeyerBusy = false;
+    host( "", 0 );
+    expectReply( "text sent", "\xC0", 1 );
+
+    // A buffered speed change waits for the text before it
+    host( "AB\x1C\x0F" "CD\x1E" "EF", 9 );
+    expectQueued( "buffered wpm", "AB" );
+    expectWpm( "buffered wpm", 25 );
+    bKeyerBusy = false;
+    host( "", 0 );
+    expectQueued( "buffered wpm", "CD" );
+    expectWpm( "buffered wpm", 15 );
+    bKeyerBusy = false;
+    host( "", 0 );
+    expectQueued( "cancel buffered wpm", "EF" );
+    expectWpm( "cancel buffered wpm", 25 );
+    bKeyerBusy = false;
+    host( "", 0 );
+    expectReply( "buffered wpm sent", "\xC0", 1 );
+
+    // A paddle press stops the text and is reported as break in
+    host( "TEST", 4 );
+    expectQueued( "break in", "TEST" );
+    paddlePresses++;
+    txLen = 0;
+    host( "", 0 );
+    expectReply( "break in", "\xC2", 1 );
+    host( "", 0 );
+    expectReply( "after break in", "\xC0", 1 );
+
+    // XOFF when the buffer is filling up because the keyer is full
+    queueSpace = 0;
+    memset( text, 'E', WINKEY_XOFF_LEVEL );
+    host( text, WINKEY_XOFF_LEVEL );
+    expectReply( "xoff", "\xC5", 1 );
+    host( "\x0A", 1 );
+    expectReply( "clear buffer", "\xC0", 1 );
+    queueSpace = 16;
+
+    // Close goes back to ignoring everything but admin commands
+    host( "\x00\x03", 2 );
+    host( "TEST", 4 );
+    expectQueued( "after close", "" );
+    expectReply( "after close", "", 0 );
+
+    if( failures )
+    {
+        printf( "winkey_test: %d failures\n", failures );
+        return 1;
+    }
+
+    printf( "winkey_test: passed\n" );
+    return 0;
+}
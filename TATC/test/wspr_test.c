@@ -0,0 +1,198 @@
+/*
+ * wspr_test.c
+ *
+ * Encodes the K1ABC FN42 37 message and checks the symbols against the
+ * reference vector from the WSPR protocol description. Also checks that
+ * messages WSPR cannot send are refused and that the beacon starts on
+ * time in the right slots.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "fsk.h"
+#include "main.h"
+#include "millis.h"
+#include "nvram.h"
+#include "wspr.h"
+
+#define WSPR_SYMBOLS 162
+
+// Channel symbols for K1ABC FN42 37
+static const uint8_t reference[WSPR_SYMBOLS] =
+{
+    3, 3, 0, 0, 2, 0, 0, 0, 1, 0, 2, 0, 1, 3, 1, 2, 2, 2, 1, 0, 0, 3, 2, 3, 1, 3, 3, 2, 2, 0,
+    2, 0, 0, 0, 3, 2, 0, 1, 2, 3, 2, 2, 0, 0, 2, 2, 3, 2, 1, 1, 0, 2, 3, 3, 2, 1, 0, 2, 2, 1,
+    3, 2, 1, 2, 2, 2, 0, 3, 3, 0, 3, 0, 3, 0, 1, 2, 1, 0, 2, 1, 2, 0, 3, 2, 1, 3, 2, 0, 0, 3,
+    3, 2, 3, 0, 3, 2, 2, 0, 3, 0, 2, 0, 2, 0, 1, 0, 2, 3, 0, 2, 1, 1, 1, 2, 3, 3, 0, 2, 3, 1,
+    2, 1, 2, 2, 2, 1, 3, 3, 2, 0, 0, 0, 0, 1, 0, 3, 2, 0, 1, 3, 2, 2, 2, 2, 2, 0, 2, 3, 3, 2,
+    3, 2, 3, 3, 2, 0, 0, 3, 1, 2, 2, 2,
+};
+
+// Simulated NVRAM
+static char wsprCall[WSPR_CALL_LEN + 1];
+static char wsprLocator[WSPR_LOCATOR_LEN + 1];
+static uint8_t wsprPower;
+
+// Simulated millisecond timer
+static uint32_t now;
+
+// Symbols given to the FSK transmitter and when it was started
+static uint8_t symbols[FSK_MAX_SYMBOLS];
+static int numSymbols;
+static int starts;
+static uint32_t startTime;
+
+static int failures;
+
+void nvramReadWsprCall( char *call )
+{
+    strcpy( call, wsprCall );
+}
+
+void nvramWriteWsprCall( const char *call )
+{
+    strncpy( wsprCall, call, WSPR_CALL_LEN );
+}
+
+void nvramReadWsprLocator( char *locator )
+{
+    strcpy( locator, wsprLocator );
+}
+
+void nvramWriteWsprLocator( const char *locator )
+{
+    strncpy( wsprLocator, locator, WSPR_LOCATOR_LEN );
+}
+
+uint8_t nvramReadWsprPower()
+{
+    return wsprPower;
+}
+
+void nvramWriteWsprPower( uint8_t power )
+{
+    wsprPower = power;
+}
+
+uint32_t millis()
+{
+    return now;
+}
+
+bool getTransmitting()
+{
+    return false;
+}
+
+void fskClear()
+{
+    numSymbols = 0;
+}
+
+bool fskAddSymbol( uint8_t tone )
+{
+    symbols[numSymbols++] = tone;
+    return true;
+}
+
+void fskSetTones( uint16_t offset, uint32_t spacing )
+{
+}
+
+bool fskSetSymbolLength( uint16_t samples )
+{
+    return true;
+}
+
+bool fskStart()
+{
+    starts++;
+    startTime = now;
+    return true;
+}
+
+bool fskSending()
+{
+    return false;
+}
+
+static void check( const char *step, bool bOK )
+{
+    if( !bOK )
+    {
+        printf( "%s: failed\n", step );
+        failures++;
+    }
+}
+
+// Run the beacon for a number of ms in 10ms steps
+static void run( uint32_t ms )
+{
+    for( uint32_t end = now + ms ; now < end ; now += 10 )
+    {
+        wsprScan();
+    }
+}
+
+int main()
+{
+    int mismatches = 0;
+
+    // Messages that cannot be sent are refused
+    check( "long call", !wsprSetMessage( "G4TGJX1", "IO91", 37 ) );
+    check( "no digit", !wsprSetMessage( "ABCDEF", "IO91", 37 ) );
+    check( "locator", !wsprSetMessage( "G4TGJ", "IZ91", 37 ) );
+    check( "short locator", !wsprSetMessage( "G4TGJ", "IO9", 37 ) );
+    check( "power", !wsprSetMessage( "G4TGJ", "IO91", 38 ) );
+    check( "default message", !wsprSetMessage( WSPR_DEFAULT_CALL, WSPR_DEFAULT_LOCATOR, WSPR_DEFAULT_POWER ) );
+
+    check( "K1ABC", wsprSetMessage( "K1ABC", "FN42", 37 ) );
+
+    // Nothing is sent until the time is set
+    wsprBeacon( 1 );
+    run( 240000 );
+    check( "no time", starts == 0 );
+
+    // Set at the start of an even minute so sends 1s later
+    uint32_t syncTime = now;
+    wsprSetTime( 0 );
+    run( 2000 );
+    check( "start", (starts == 1) &&
+                    ((startTime - syncTime) >= WSPR_START_TIME) &&
+                    ((startTime - syncTime) < (WSPR_START_TIME + WSPR_START_WINDOW)) );
+
+    check( "symbols", numSymbols == WSPR_SYMBOLS );
+    for( int i = 0 ; i < WSPR_SYMBOLS ; i++ )
+    {
+        if( symbols[i] != reference[i] )
+        {
+            printf( "symbol %d: expected %d, got %d\n", i, reference[i], symbols[i] );
+            mismatches++;
+        }
+    }
+    check( "reference vector", mismatches == 0 );
+
+    // Only once per slot
+    run( 100000 );
+    check( "one per slot", starts == 1 );
+
+    // Every fifth slot
+    wsprBeacon( 5 );
+    starts = 0;
+    run( 20 * 120000 );
+    check( "every fifth slot", starts == 4 );
+
+    if( failures )
+    {
+        printf( "wspr_test: %d failures\n", failures );
+        return 1;
+    }
+
+    printf( "wspr_test: %d symbols match the reference - passed\n", WSPR_SYMBOLS );
+    return 0;
+}
@@ -0,0 +1,443 @@
+/*
+ * winkey.c
+ *
+ * Emulates enough of the K1EL WinKeyer 2 host protocol for loggers to
+ * send CW through the keyer. When the serial port is set to WinKeyer
+ * instead of CAT the main loop calls winkeyControl() which reads and
+ * writes the serial port itself.
+ *
+ * Text is held in a buffer and fed into the keyer's queue from the main
+ * loop. XOFF is reported in the status byte when the buffer is getting
+ * full so that the host stops sending until there is room.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+
+#include "config.h"
+#include "keyer.h"
+#include "morse.h"
+#include "serial.h"
+#include "winkey.h"
+
+#ifndef SOTA2
+
+// Commands from the host
+#define WK_ADMIN            0x00
+#define WK_SET_WPM          0x02
+#define WK_SETUP_POT        0x05
+#define WK_GET_POT          0x07
+#define WK_BACKSPACE        0x08
+#define WK_CLEAR_BUFFER     0x0A
+#define WK_GET_STATUS       0x15
+#define WK_BUFFERED_WPM     0x1C
+#define WK_CANCEL_WPM       0x1E
+#define WK_FIRST_TEXT       0x20
+
+// Admin sub commands
+#define WK_ADMIN_CALIBRATE  0
+#define WK_ADMIN_RESET      1
+#define WK_ADMIN_OPEN       2
+#define WK_ADMIN_CLOSE      3
+#define WK_ADMIN_ECHO       4
+#define WK_ADMIN_SEND_MSG   14
+#define WK_ADMIN_XMODE      15
+
+// Status byte and its bits
+#define WK_STATUS           0xC0
+#define WK_STATUS_XOFF      0x01
+#define WK_STATUS_BREAKIN   0x02
+#define WK_STATUS_BUSY      0x04
+
+// Speed pot byte
+#define WK_POT              0x80
+
+// Number of parameters for each command (admin is handled separately)
+static const uint8_t commandParams[WK_FIRST_TEXT] =
+{
+    0, 1, 1, 1, 2, 3, 1, 0, 0, 1, 0, 1, 1, 1, 1, 15,
+    1, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1, 2, 1, 1, 0, 0,
+};
+
+// Largest number of parameters that are kept
+#define MAX_PARAMS 3
+
+// True when the host has opened the WinKeyer
+static bool bHostOpen;
+
+// What the next byte from the host is expected to be
+static enum
+{
+    wkIdle,         // Command or text
+    wkAdmin,        // Admin sub command
+    wkParams        // Parameter for the command
+} rxState;
+
+// The command being received and its parameters
+static uint8_t command;
+static bool bAdmin;
+static uint8_t params[MAX_PARAMS];
+static uint8_t numParams;
+static uint8_t paramsLeft;
+
+// Buffer of text and buffered commands from the host
+static uint8_t buffer[WINKEY_BUFFER_LEN];
+static uint8_t bufferHead, bufferTail, bufferCount;
+
+// Bytes to send back to the host
+static uint8_t txBuffer[WINKEY_TX_LEN];
+static uint8_t txHead, txTail, txCount;
+
+// The last status sent so that only changes are sent
+static uint8_t lastStatus;
+
+// True if text has been passed to the keyer and not yet all sent
+static bool bSending;
+
+// The keyer's paddle press count when the text started
+static uint8_t paddlePresses;
+
+// Set when a paddle has stopped the text until it has been reported
+static bool bBreakIn;
+
+// Minimum speed of the speed pot and the speed before a buffered change
+static uint8_t potMinWpm = MIN_MORSE_WPM;
+static uint8_t savedWpm;
+
+// Queue a byte to send to the host
+// Silently dropped if there is no room
+static void transmit( uint8_t data )
+{
+    if( txCount < WINKEY_TX_LEN )
+    {
+        txBuffer[txHead] = data;
+        txHead = (txHead + 1) % WINKEY_TX_LEN;
+        txCount++;
+    }
+}
+
+// Add a byte to the text buffer
+static void bufferAdd( uint8_t data )
+{
+    if( bufferCount < WINKEY_BUFFER_LEN )
+    {
+        buffer[bufferHead] = data;
+        bufferHead = (bufferHead + 1) % WINKEY_BUFFER_LEN;
+        bufferCount++;
+    }
+}
+
+// Throw away the buffered text and anything the keyer has not sent
+static void bufferClear()
+{
+    bufferHead = bufferTail = bufferCount = 0;
+    keyerClearQueue();
+}
+
+// Set the speed if it is in range
+static void setWpm( uint8_t wpm )
+{
+    if( (wpm >= MIN_MORSE_WPM) && (wpm <= MAX_MORSE_WPM) )
+    {
+        morseSetWpm( wpm );
+    }
+}
+
+// Work out the status byte
+static uint8_t status()
+{
+    uint8_t s = WK_STATUS;
+
+    if( bufferCount >= WINKEY_XOFF_LEVEL )
+    {
+        s |= WK_STATUS_XOFF;
+    }
+    if( bBreakIn )
+    {
+        s |= WK_STATUS_BREAKIN;
+    }
+    if( bufferCount || keyerSendingText() )
+    {
+        s |= WK_STATUS_BUSY;
+    }
+
+    return s;
+}
+
+// Act on an admin command once all its parameters are in
+static void adminCommand( uint8_t subCommand )
+{
+    switch( subCommand )
+    {
+        case WK_ADMIN_OPEN:
+            bHostOpen = true;
+            bufferClear();
+            transmit( WINKEY_VERSION );
+            lastStatus = 0;
+            break;
+
+        case WK_ADMIN_CLOSE:
+        case WK_ADMIN_RESET:
+            bHostOpen = false;
+            bufferClear();
+            break;
+
+        case WK_ADMIN_ECHO:
+            transmit( params[0] );
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Act on a command once all its parameters are in
+static void hostCommand()
+{
+    switch( command )
+    {
+        case WK_SET_WPM:
+            // 0 means use the speed pot so leave it as it is
+            setWpm( params[0] );
+            break;
+
+        case WK_SETUP_POT:
+            potMinWpm = params[0];
+            break;
+
+        case WK_GET_POT:
+        {
+            uint8_t wpm = morseGetWpm();
+            transmit( WK_POT | ((wpm > potMinWpm) ? (wpm - potMinWpm) : 0) );
+            break;
+        }
+
+        case WK_BACKSPACE:
+            if( bufferCount )
+            {
+                bufferHead = (bufferHead + WINKEY_BUFFER_LEN - 1) % WINKEY_BUFFER_LEN;
+                bufferCount--;
+            }
+            break;
+
+        case WK_CLEAR_BUFFER:
+            bufferClear();
+            break;
+
+        case WK_GET_STATUS:
+            transmit( status() );
+            break;
+
+        case WK_BUFFERED_WPM:
+            // Changes speed when the text before it has been sent
+            bufferAdd( command );
+            bufferAdd( params[0] );
+            break;
+
+        case WK_CANCEL_WPM:
+            bufferAdd( command );
+            break;
+
+        default:
+            // Other commands are accepted but have no effect
+            break;
+    }
+}
+
+// Act on the command once all its parameters are in
+static void doCommand()
+{
+    if( bAdmin )
+    {
+        adminCommand( command );
+    }
+    else
+    {
+        hostCommand();
+    }
+    rxState = wkIdle;
+}
+
+// Start collecting the parameters for a command
+// Acts on the command straight away if it has none
+static void startParams( uint8_t num )
+{
+    numParams = 0;
+    paramsLeft = num;
+    rxState = wkParams;
+
+    if( num == 0 )
+    {
+        doCommand();
+    }
+}
+
+// Handle a byte received from the host
+static void receive( uint8_t data )
+{
+    // Until the host opens the WinKeyer only an admin command is taken
+    if( !bHostOpen && (rxState == wkIdle) && (data != WK_ADMIN) )
+    {
+        return;
+    }
+
+    switch( rxState )
+    {
+        case wkIdle:
+            if( data == WK_ADMIN )
+            {
+                rxState = wkAdmin;
+            }
+            else if( data < WK_FIRST_TEXT )
+            {
+                command = data;
+                bAdmin = false;
+                startParams( commandParams[data] );
+            }
+            else
+            {
+                // Text to send
+                bufferAdd( data );
+            }
+            break;
+
+        case wkAdmin:
+            // The byte after admin says which admin command it is
+            command = data;
+            bAdmin = true;
+            switch( data )
+            {
+                case WK_ADMIN_CALIBRATE:
+                case WK_ADMIN_ECHO:
+                case WK_ADMIN_SEND_MSG:
+                case WK_ADMIN_XMODE:
+                    startParams( 1 );
+                    break;
+
+                default:
+                    startParams( 0 );
+                    break;
+            }
+            break;
+
+        case wkParams:
+        default:
+            // Keep the first few parameters, ignore the rest
+            if( numParams < MAX_PARAMS )
+            {
+                params[numParams++] = data;
+            }
+            if( --paramsLeft == 0 )
+            {
+                doCommand();
+            }
+            break;
+    }
+}
+
+// Feed the buffered text to the keyer and report status changes
+static void scan()
+{
+    uint8_t data;
+    uint8_t newStatus;
+
+    if( bHostOpen )
+    {
+        // A paddle press stops the text
+        if( bSending && (keyerPaddlePresses() != paddlePresses) )
+        {
+            bufferClear();
+            bBreakIn = true;
+        }
+
+        // Top up the keyer's queue
+        while( bufferCount && keyerQueueSpace() )
+        {
+            data = buffer[bufferTail];
+
+            if( (data == WK_BUFFERED_WPM) || (data == WK_CANCEL_WPM) )
+            {
+                // Speed changes wait until the text before them has gone
+                // as the keyer only picks up a new speed when idle
+                if( keyerSendingText() )
+                {
+                    break;
+                }
+
+                if( data == WK_BUFFERED_WPM )
+                {
+                    // The speed follows in the buffer
+                    if( bufferCount < 2 )
+                    {
+                        break;
+                    }
+                    bufferTail = (bufferTail + 1) % WINKEY_BUFFER_LEN;
+                    bufferCount--;
+                    savedWpm = morseGetWpm();
+                    setWpm( buffer[bufferTail] );
+                }
+                else if( savedWpm )
+                {
+                    setWpm( savedWpm );
+                    savedWpm = 0;
+                }
+            }
+            else
+            {
+                keyerQueueChar( data );
+                if( !bSending )
+                {
+                    // Starting to send so only a paddle press from
+                    // now on stops it
+                    paddlePresses = keyerPaddlePresses();
+                    bSending = true;
+                }
+            }
+
+            bufferTail = (bufferTail + 1) % WINKEY_BUFFER_LEN;
+            bufferCount--;
+        }
+
+        if( !keyerSendingText() )
+        {
+            bSending = false;
+        }
+
+        // Tell the host about any change in status
+        newStatus = status();
+        if( newStatus != lastStatus )
+        {
+            transmit( newStatus );
+            lastStatus = newStatus;
+        }
+
+        // Break in only needs reporting once
+        bBreakIn = false;
+    }
+}
+
+// Handle everything from the host, keep the keyer supplied with text
+// and send any replies
+// Call from the main loop when the serial port is set to WinKeyer
+void winkeyControl()
+{
+    uint8_t data;
+
+    while( serialReceive( &data ) )
+    {
+        receive( data );
+    }
+
+    scan();
+
+    while( txCount )
+    {
+        serialTransmit( txBuffer[txTail] );
+        txTail = (txTail + 1) % WINKEY_TX_LEN;
+        txCount--;
+    }
+}
+
+#endif
@@ -0,0 +1,19 @@
+/*
+ * winkey.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef WINKEY_H
+#define WINKEY_H
+
+#include <inttypes.h>
+
+// Handle everything from the host, keep the keyer supplied with text
+// and send any replies
+// Call from the main loop when the serial port is set to WinKeyer
+void winkeyControl();
+
+#endif //WINKEY_H
@@ -0,0 +1,337 @@
+/*
+ * wspr.c
+ *
+ * A WSPR beacon. The callsign, locator and power from the NVRAM are
+ * encoded into the 162 WSPR symbols which are then sent with the FSK
+ * transmitter at the start of an even minute.
+ *
+ * The encoding is done once when the message changes. The 50 bit
+ * message goes through the K=32 rate 1/2 convolutional code and is
+ * interleaved by bit reversed address straight into a bit array so
+ * only the data bits have to be kept in RAM. Each symbol is the sync
+ * bit plus twice the data bit.
+ *
+ * The time is set from the menu by pressing at the start of an even
+ * minute and is kept by the millisecond timer so it will drift - it
+ * is best set again every so often.
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+
+#include <inttypes.h>
+#include <ctype.h>
+#include <string.h>
+
+#include "config.h"
+#include "fsk.h"
+#include "main.h"
+#include "millis.h"
+#include "nvram.h"
+#include "wspr.h"
+
+#ifndef SOTA2
+
+#define WSPR_SYMBOLS    162
+#define WSPR_BYTES      ((WSPR_SYMBOLS + 7) / 8)
+
+// The message is 50 bits followed by 31 zero bits to flush the encoder
+#define WSPR_MESSAGE_BITS   81
+#define WSPR_MESSAGE_BYTES  11
+
+// Convolutional code polynomials
+#define WSPR_POLY1      0xF2D05351UL
+#define WSPR_POLY2      0xE4613C47UL
+
+// Length of a transmission slot (ms)
+#define WSPR_SLOT_TIME  120000UL
+
+// Sync vector - 1 bit per symbol, least significant bit first
+static const uint8_t syncVector[WSPR_BYTES] =
+{
+    0x03, 0x71, 0xA4, 0x07, 0xA4, 0x40, 0xB3, 0x58, 0x58, 0x95, 0x34,
+    0x56, 0x04, 0xC9, 0xCD, 0xE2, 0xA0, 0x0C, 0x58, 0x63, 0x00,
+};
+
+// Encoded and interleaved data bits in the same format
+static uint8_t dataBits[WSPR_BYTES];
+
+// True once dataBits holds the current message
+static bool bEncoded;
+
+// Slot interval for the beacon, 0 if off
+static uint8_t beaconInterval;
+
+// The time set (s) and the millisecond timer when it was set
+static bool bTimeSet;
+static uint32_t syncSeconds;
+static uint32_t syncMillis;
+
+// The last slot a transmission was started in
+static uint32_t lastSlot = UINT32_MAX;
+
+// Get a bit from a symbol bit array
+static uint8_t getBit( const uint8_t *bits, uint8_t symbol )
+{
+    return (bits[symbol / 8] >> (symbol % 8)) & 1;
+}
+
+// Parity of a 32 bit value
+static uint8_t parity( uint32_t value )
+{
+    uint8_t p = (uint8_t)(value ^ (value >> 8) ^ (value >> 16) ^ (value >> 24));
+
+    p ^= p >> 4;
+    p ^= p >> 2;
+    p ^= p >> 1;
+
+    return p & 1;
+}
+
+// Reverse the order of the bits in a byte
+static uint8_t reverseBits( uint8_t value )
+{
+    uint8_t result = 0;
+
+    for( uint8_t i = 0 ; i < 8 ; i++ )
+    {
+        result = (result << 1) | (value & 1);
+        value >>= 1;
+    }
+
+    return result;
+}
+
+// Value of a callsign or locator character: 0-9, A-Z then space
+static uint8_t charValue( char c )
+{
+    uint8_t value;
+
+    if( isdigit( c ) )
+    {
+        value = c - '0';
+    }
+    else if( isalpha( c ) )
+    {
+        value = toupper( c ) - 'A' + 10;
+    }
+    else
+    {
+        value = 36;
+    }
+
+    return value;
+}
+
+// Put a callsign into the 6 character WSPR form where the third
+// character is a digit and it is padded with spaces
+// Returns false if it cannot be sent
+static bool padCall( const char *call, char *padded )
+{
+    uint8_t len = strlen( call );
+    uint8_t start = 0;
+    bool bValid = true;
+
+    // A single character prefix needs a leading space
+    if( (len > 2) && !isdigit( call[2] ) )
+    {
+        start = 1;
+    }
+
+    if( (len == 0) || ((len + start) > WSPR_CALL_LEN) )
+    {
+        bValid = false;
+    }
+    else
+    {
+        memset( padded, ' ', WSPR_CALL_LEN );
+        memcpy( &padded[start], call, len );
+
+        for( uint8_t i = 0 ; i < WSPR_CALL_LEN ; i++ )
+        {
+            char c = padded[i];
+
+            if( ((i == 2) && !isdigit( c )) ||
+                ((i < 2) && !isalnum( c ) && ((i == 1) || (c != ' '))) ||
+                ((i > 2) && !isalpha( c ) && (c != ' ')) )
+            {
+                bValid = false;
+            }
+        }
+    }
+
+    return bValid;
+}
+
+// True if a locator is a valid 4 character Maidenhead locator
+static bool validLocator( const char *locator )
+{
+    return (strlen( locator ) == WSPR_LOCATOR_LEN) &&
+           (toupper( locator[0] ) >= 'A') && (toupper( locator[0] ) <= 'R') &&
+           (toupper( locator[1] ) >= 'A') && (toupper( locator[1] ) <= 'R') &&
+           isdigit( locator[2] ) && isdigit( locator[3] );
+}
+
+// True if the power is one of the levels WSPR can send (0-60dBm ending 0, 3 or 7)
+static bool validPower( uint8_t power )
+{
+    uint8_t units = power % 10;
+
+    return (power <= 60) && ((units == 0) || (units == 3) || (units == 7));
+}
+
+// Encode the message from the NVRAM into the data bits
+// Returns false if the message is not valid
+static bool encode()
+{
+    char call[WSPR_CALL_LEN + 1];
+    char padded[WSPR_CALL_LEN];
+    char locator[WSPR_LOCATOR_LEN + 1];
+    uint8_t power = nvramReadWsprPower();
+    uint8_t message[WSPR_MESSAGE_BYTES];
+    uint32_t n, m;
+    uint32_t reg = 0;
+    uint8_t bit = 0;
+    uint8_t symbol = 0;
+
+    nvramReadWsprCall( call );
+    nvramReadWsprLocator( locator );
+
+    bEncoded = padCall( call, padded ) && validLocator( locator ) && validPower( power );
+    if( bEncoded )
+    {
+        // Callsign into 28 bits
+        n = charValue( padded[0] );
+        n = n * 36 + charValue( padded[1] );
+        n = n * 10 + charValue( padded[2] );
+        for( uint8_t i = 3 ; i < WSPR_CALL_LEN ; i++ )
+        {
+            n = n * 27 + charValue( padded[i] ) - 10;
+        }
+
+        // Locator and power into 22 bits
+        m = (179 - 10 * (charValue( locator[0] ) - 10) - charValue( locator[2] )) * 180UL +
+            10 * (charValue( locator[1] ) - 10) + charValue( locator[3] );
+        m = m * 128 + power + 64;
+
+        memset( message, 0, sizeof( message ) );
+        message[0] = n >> 20;
+        message[1] = n >> 12;
+        message[2] = n >> 4;
+        message[3] = (n << 4) | ((m >> 18) & 0x0F);
+        message[4] = m >> 10;
+        message[5] = m >> 2;
+        message[6] = m << 6;
+
+        // Each message bit makes two code bits which are interleaved
+        // by putting the next one at the bit reversed address,
+        // skipping addresses beyond the last symbol
+        memset( dataBits, 0, sizeof( dataBits ) );
+        for( uint16_t address = 0 ; symbol < WSPR_SYMBOLS ; address++ )
+        {
+            uint8_t dest = reverseBits( address );
+
+            if( dest < WSPR_SYMBOLS )
+            {
+                uint32_t poly = WSPR_POLY2;
+
+                if( (symbol & 1) == 0 )
+                {
+                    reg = (reg << 1) | ((message[bit / 8] >> (7 - (bit % 8))) & 1);
+                    bit++;
+                    poly = WSPR_POLY1;
+                }
+
+                if( parity( reg & poly ) )
+                {
+                    dataBits[dest / 8] |= 1 << (dest % 8);
+                }
+                symbol++;
+            }
+        }
+    }
+
+    return bEncoded;
+}
+
+// Load the symbols into the FSK transmitter and start sending
+static void send()
+{
+    if( bEncoded || encode() )
+    {
+        fskClear();
+        fskSetTones( WSPR_OFFSET, WSPR_SPACING );
+        fskSetSymbolLength( WSPR_SYMBOL_LEN );
+
+        for( uint8_t i = 0 ; i < WSPR_SYMBOLS ; i++ )
+        {
+            fskAddSymbol( getBit( syncVector, i ) + 2 * getBit( dataBits, i ) );
+        }
+
+        fskStart();
+    }
+}
+
+// Set the callsign, locator and power (dBm) to send
+// They are stored in the NVRAM. Returns false if they cannot be sent
+// in a WSPR message.
+bool wsprSetMessage( const char *call, const char *locator, uint8_t power )
+{
+    char padded[WSPR_CALL_LEN];
+    bool bValid = padCall( call, padded ) && validLocator( locator ) && validPower( power );
+
+    if( bValid )
+    {
+        nvramWriteWsprCall( call );
+        nvramWriteWsprLocator( locator );
+        nvramWriteWsprPower( power );
+        encode();
+    }
+
+    return bValid;
+}
+
+// Set the time
+// The time is in seconds since any even minute e.g. since midnight UTC
+void wsprSetTime( uint32_t seconds )
+{
+    syncSeconds = seconds;
+    syncMillis = millis();
+    bTimeSet = true;
+    lastSlot = UINT32_MAX;
+}
+
+// True once the time has been set
+bool wsprTimeSet()
+{
+    return bTimeSet;
+}
+
+// Send a beacon every interval 2 minute slots, 0 for off
+// Nothing is sent until the time has been set
+void wsprBeacon( uint8_t interval )
+{
+    beaconInterval = interval;
+}
+
+// Start a transmission when one is due - call from the main loop
+void wsprScan()
+{
+    if( beaconInterval && bTimeSet && !fskSending() && !getTransmitting() )
+    {
+        // Work out which slot we are in and how far into it
+        uint32_t time = (syncSeconds % (WSPR_SLOT_TIME / 1000)) * 1000 + (millis() - syncMillis);
+        uint32_t slot = syncSeconds / (WSPR_SLOT_TIME / 1000) + time / WSPR_SLOT_TIME;
+
+        time %= WSPR_SLOT_TIME;
+
+        if( (time >= WSPR_START_TIME) && (time < (WSPR_START_TIME + WSPR_START_WINDOW)) &&
+            (slot != lastSlot) && ((slot % beaconInterval) == 0) )
+        {
+            lastSlot = slot;
+            send();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * wspr.h
+ *
+ * Created: 17/10/2026
+ * Author : Richard Tomlinson G4TGJ
+ */ 
+ 
+
+#ifndef WSPR_H
+#define WSPR_H
+
+#include <inttypes.h>
+
+// Set the callsign, locator and power (dBm) to send
+// They are stored in the NVRAM. Returns false if they cannot be sent
+// in a WSPR message.
+bool wsprSetMessage( const char *call, const char *locator, uint8_t power );
+
+// Set the time
+// The time is in seconds since any even minute e.g. since midnight UTC
+void wsprSetTime( uint32_t seconds );
+
+// True once the time has been set
+bool wsprTimeSet();
+
+// Send a beacon every interval 2 minute slots, 0 for off
+// Nothing is sent until the time has been set
+void wsprBeacon( uint8_t interval );
+
+// Start a transmission when one is due - call from the main loop
+void wsprScan();
+
+#endif //WSPR_H